@@ -0,0 +1,94 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/*
+* Single channel benchmark of the DSD to PCM converter classes.
+*
+* Build (Linux):
+*   g++ -O2 -march=native -std=c++17 -I../libdsdpcm dsdpcm_bench.cpp -o dsdpcm_bench
+*
+* Usage: dsdpcm_bench [seconds per case]
+*
+* Every Multistage and Direct converter from x8 to x512 is run for fp32 and
+* fp64 on deterministic pseudo-random DSD. The DSD rate is DSD64 up to x64 and
+* scales with the decimation above it, so each case produces at least 44.1kHz.
+*/
+
+#include <chrono>
+
+#include "dsdpcm_bench.h"
+
+static const int BENCH_FRAMERATE = 75;
+static const int BENCH_FRAMES = 16;
+
+template<typename real_t>
+void run_case(conv_type_e conv_type, int decimation, double seconds) {
+	int dsd_samplerate = DSDxFs64 * (decimation > 64 ? decimation / 64 : 1);
+	int dsd_samples = dsd_samplerate / 8 / BENCH_FRAMERATE;
+	int pcm_samples = dsd_samples * 8 / decimation;
+	uint8_t* dsd_data = (uint8_t*)DSDPCMUtil::mem_alloc(BENCH_FRAMES * dsd_samples);
+	real_t* pcm_data = (real_t*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(real_t));
+	bench_source_t source;
+	source.fill(dsd_data, BENCH_FRAMES * dsd_samples);
+	DSDPCMFilterSetup<real_t> fltSetup;
+	DSDPCMConverter<real_t>* converter = new_converter<real_t>(conv_type, decimation);
+	converter->init(fltSetup, dsd_samples);
+	converter->convert(dsd_data, pcm_data, dsd_samples);
+	int64_t frames = 0;
+	int64_t out_samples = 0;
+	double elapsed = 0.0;
+	auto t0 = std::chrono::steady_clock::now();
+	while (elapsed < seconds) {
+		for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+			out_samples += converter->convert(dsd_data + frame * dsd_samples, pcm_data, dsd_samples);
+		}
+		frames += BENCH_FRAMES;
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	}
+	double dsd_bytes = (double)frames * dsd_samples;
+	double audio_seconds = (double)frames / BENCH_FRAMERATE;
+	printf("%-10s x%-4d %s  DSD%-4d %9.1f MB/s %9.2f ns/sample %8.1fx realtime %8.1f KiB tables\n",
+		conv_type == DSDPCM_CONV_MULTISTAGE ? "Multistage" : "Direct",
+		decimation,
+		sizeof(real_t) == sizeof(float) ? "fp32" : "fp64",
+		dsd_samplerate / 44100,
+		dsd_bytes / elapsed / 1e6,
+		elapsed * 1e9 / (double)out_samples,
+		audio_seconds / elapsed,
+		fltSetup.get_ctables_bytes() / 1024.0
+	);
+	delete converter;
+	DSDPCMUtil::mem_free(pcm_data);
+	DSDPCMUtil::mem_free(dsd_data);
+}
+
+int main(int argc, char* argv[]) {
+	double seconds = (argc > 1) ? atof(argv[1]) : 0.5;
+	if (seconds <= 0.0) {
+		seconds = 0.5;
+	}
+	conv_type_e conv_types[] = { DSDPCM_CONV_MULTISTAGE, DSDPCM_CONV_DIRECT };
+	for (int t = 0; t < 2; t++) {
+		for (int decimation = 8; decimation <= 512; decimation *= 2) {
+			run_case<float>(conv_types[t], decimation, seconds);
+			run_case<double>(conv_types[t], decimation, seconds);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "DSDPCMConverterMultistage.h"
+#include "DSDPCMConverterDirect.h"
+
+class bench_source_t {
+	uint32_t seed;
+public:
+	bench_source_t() {
+		seed = 0x5ACD5ACD;
+	}
+	void fill(uint8_t* dsd_data, int dsd_samples) {
+		for (int i = 0; i < dsd_samples; i++) {
+			seed = seed * 1664525u + 1013904223u;
+			dsd_data[i] = (uint8_t)(seed >> 24);
+		}
+	}
+	void fill_tone(uint8_t* dsd_data, int dsd_samples, double frequency, int dsd_samplerate) {
+		// First order sigma-delta modulated -6dB sine, MSB first
+		const double pi = 3.14159265358979323846;
+		double integrator = 0.0;
+		int bit = 1;
+		for (int i = 0; i < dsd_samples; i++) {
+			uint8_t byte = 0;
+			for (int j = 0; j < 8; j++) {
+				double x = 0.5 * sin(2.0 * pi * frequency * (8.0 * i + j) / dsd_samplerate);
+				integrator += x - (bit ? 1.0 : -1.0);
+				bit = integrator >= 0.0;
+				byte = (uint8_t)((byte << 1) | bit);
+			}
+			dsd_data[i] = byte;
+		}
+	}
+};
+
+template<typename real_t>
+DSDPCMConverter<real_t>* new_converter(conv_type_e conv_type, int decimation) {
+	if (conv_type == DSDPCM_CONV_MULTISTAGE || conv_type == DSDPCM_CONV_LOWLATENCY) {
+		switch (decimation) {
+		case 512:
+			return new DSDPCMConverterMultistage_x512<real_t>();
+		case 256:
+			return new DSDPCMConverterMultistage_x256<real_t>();
+		case 128:
+			return new DSDPCMConverterMultistage_x128<real_t>();
+		case 64:
+			return new DSDPCMConverterMultistage_x64<real_t>();
+		case 32:
+			return new DSDPCMConverterMultistage_x32<real_t>();
+		case 16:
+			return new DSDPCMConverterMultistage_x16<real_t>();
+		case 8:
+			return new DSDPCMConverterMultistage_x8<real_t>();
+		}
+	}
+	else {
+		switch (decimation) {
+		case 512:
+			return new DSDPCMConverterDirect_x512<real_t>();
+		case 256:
+			return new DSDPCMConverterDirect_x256<real_t>();
+		case 128:
+			return new DSDPCMConverterDirect_x128<real_t>();
+		case 64:
+			return new DSDPCMConverterDirect_x64<real_t>();
+		case 32:
+			return new DSDPCMConverterDirect_x32<real_t>();
+		case 16:
+			return new DSDPCMConverterDirect_x16<real_t>();
+		case 8:
+			return new DSDPCMConverterDirect_x8<real_t>();
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,775 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+/*
+* Accuracy check of the converter kernel variants against the reference.
+*
+* Build (Linux):
+*   g++ -O2 -march=native -std=c++17 -I../libdsdpcm dsdpcm_verify.cpp -o dsdpcm_verify
+*
+* Usage: dsdpcm_verify [max abs error] [frames]
+*
+* The reference is the scalar DSDPCMFir/PCMPCMFir cascade in fp64 with radix 8
+* fp64 tables, for every Multistage, Direct and Min phase (Low latency)
+* decimation. Every channel gets its own DSD (a sigma-delta modulated tone,
+* then pseudo-random data, then the last quarter idle pattern) and is compared
+* with its own reference. Variants with extra latency (FFT) are aligned by
+* their reported delay. The exit code is 1 if any variant exceeds the
+* tolerance (default 1e-5).
+*
+* The unfused, multirate, time split and silence variants restructure a run
+* without touching its arithmetic. They are compared with the plain run of
+* their own precision (lanes for lanes silence) and must match it exactly.
+*
+* The polyphase check resamples the 44.1 kHz family cascades by 160/147 and
+* compares single precision, fixed point and lanes runs with the fp64 one.
+*
+* The downmix check mixes two different channels with gains beyond unity in
+* the lanes converter and compares the result with the reference conversion
+* of each channel followed by the same mix in double.
+*
+* The overload check drives a 100 Hz tone past full scale into the noise
+* shaped int16 quantizer, then drops it by 60 dB. Every sample must stay
+* within VERIFY_OVERLOAD_LSB of the clipped input.
+*
+* The quantizer check writes known values as the second of two int24 and
+* int32 channels and decodes the bytes, compares the vector loop with the
+* scalar one, measures the dither error level (1/4 LSB^2 with TPDF, 1/12
+* without) and requires the shaped error to sit at least
+* VERIFY_SHAPING_DB lower in the bottom sixteenth of the band than in the top one.
+*/
+
+#include <string.h>
+#include <vector>
+
+#include "dsdpcm_bench.h"
+#include "DSDPCMConverterLanes.h"
+#include "DSDPCMConverterMultirate.h"
+#include "DSDPCMConverterPolyphase.h"
+#include "DSDPCMQuantizer.h"
+
+static const int VERIFY_FRAMERATE = 75;
+static const int VERIFY_CHANNELS = 2;
+static const double VERIFY_OVERLOAD_LSB = 8.0;
+static const double VERIFY_SHAPING_DB = 25.0;
+static const double verify_downmix_matrix[] = {
+	 1.5,  0.75,
+	-1.0,  0.5
+};
+
+enum verify_kind_e {
+	VERIFY_SLOT      = 0,
+	VERIFY_LANES     = 1,
+	VERIFY_FFT       = 2,
+	VERIFY_UNFUSED   = 3,
+	VERIFY_MULTIRATE = 4,
+	VERIFY_SPLIT     = 5,
+	VERIFY_SILENCE   = 6,
+	VERIFY_LANES_SILENCE = 7
+};
+
+class verify_variant_t {
+public:
+	const char*   name;
+	int           precision;
+	int           radix;
+	bool          fp32;
+	bool          symmetric;
+	bool          sum_fp64;
+	int           planes;
+	verify_kind_e kind;
+	bool is_exact() const {
+		return kind == VERIFY_UNFUSED || kind == VERIFY_MULTIRATE || kind == VERIFY_SPLIT || kind == VERIFY_SILENCE || kind == VERIFY_LANES_SILENCE;
+	}
+};
+
+static const verify_variant_t verify_variants[] = {
+	{ "fp32",            32, 8,  true,  false, false, 0,  VERIFY_SLOT      },
+	{ "fp32 mixed",      32, 8,  true,  false, true,  0,  VERIFY_SLOT      },
+	{ "fp64 fp32-tab",   64, 8,  true,  false, false, 0,  VERIFY_SLOT      },
+	{ "fp64 radix4",     64, 4,  false, false, false, 0,  VERIFY_SLOT      },
+	{ "fp64 radix16",    64, 16, false, false, false, 0,  VERIFY_SLOT      },
+	{ "fp64 symmetric",  64, 8,  false, true,  false, 0,  VERIFY_SLOT      },
+	{ "fixed",           0,  8,  false, false, false, 0,  VERIFY_SLOT      },
+	{ "fp32 planes24",   32, 8,  false, false, false, 24, VERIFY_SLOT      },
+	{ "fp64 planes32",   64, 8,  false, false, false, 32, VERIFY_SLOT      },
+	{ "fixed planes32",  0,  8,  false, false, false, 32, VERIFY_SLOT      },
+	{ "lanes fp32",      32, 8,  true,  false, false, 0,  VERIFY_LANES     },
+	{ "lanes fp64",      64, 8,  false, false, false, 0,  VERIFY_LANES     },
+	{ "lanes fixed",     0,  8,  false, false, false, 0,  VERIFY_LANES     },
+	{ "lanes planes32",  64, 8,  false, false, false, 32, VERIFY_LANES     },
+	{ "fft fp32",        32, 8,  true,  false, false, 0,  VERIFY_FFT       },
+	{ "fft fp64",        64, 8,  false, false, false, 0,  VERIFY_FFT       },
+	{ "fp64 unfused",    64, 8,  false, false, false, 0,  VERIFY_UNFUSED   },
+	{ "fixed unfused",   0,  8,  false, false, false, 0,  VERIFY_UNFUSED   },
+	{ "fp64 multirate",  64, 8,  false, false, false, 0,  VERIFY_MULTIRATE },
+	{ "fixed multirate", 0,  8,  false, false, false, 0,  VERIFY_MULTIRATE },
+	{ "fp64 split",      64, 8,  false, false, false, 0,  VERIFY_SPLIT     },
+	{ "fixed split",     0,  8,  false, false, false, 0,  VERIFY_SPLIT     },
+	{ "fp32 silence",    32, 8,  true,  false, false, 0,  VERIFY_SILENCE   },
+	{ "fixed silence",   0,  8,  false, false, false, 0,  VERIFY_SILENCE   },
+	{ "lanes silence",   32, 8,  true,  false, false, 0,  VERIFY_LANES_SILENCE },
+	{ "lanes fixed sil", 0,  8,  false, false, false, 0,  VERIFY_LANES_SILENCE },
+};
+
+static const verify_variant_t verify_reference = { "reference", 64, 8, false, false, false, 0, VERIFY_SLOT };
+
+class verify_result_t {
+public:
+	double max_error;
+	double signal;
+	double noise;
+	int64_t first_error;
+	verify_result_t() {
+		max_error = 0.0;
+		signal = 0.0;
+		noise = 0.0;
+		first_error = -1;
+	}
+	double get_snr() {
+		return (noise > 0.0) ? 10.0 * log10(signal / noise) : INFINITY;
+	}
+};
+
+/*
+* Multistage cascade run stage after stage on whole frames, the way it ran
+* before the fused blocks.
+*/
+template<typename real_t>
+class verify_unfused_t : public DSDPCMConverter<real_t> {
+	DSDPCMFir<real_t> dsd_fir1;
+	PCMPCMFir<real_t> pcm_fir[DSDPCM_MULTIRATE_LEVELS];
+	int pcm_stages;
+	int decimation;
+public:
+	verify_unfused_t(int decimation) {
+		this->pcm_stages = 0;
+		this->decimation = decimation;
+	}
+	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
+		int fir1_decimation = (decimation >= 64) ? 16 : 8;
+		if (fir1_decimation == 16) {
+			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
+		}
+		else {
+			dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
+		}
+		this->delay = dsd_fir1.get_delay();
+		pcm_stages = 0;
+		for (int d = 2 * fir1_decimation; d < decimation; d *= 2) {
+			pcm_fir[pcm_stages].init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
+			this->delay = this->delay / 2 + pcm_fir[pcm_stages].get_delay();
+			pcm_stages++;
+		}
+		if (decimation > fir1_decimation) {
+			pcm_fir[pcm_stages].init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+			this->delay = this->delay / 2 + pcm_fir[pcm_stages].get_delay();
+			pcm_stages++;
+		}
+		this->alloc_pcm_temp1(dsd_samples * 8 / fir1_decimation);
+		this->alloc_pcm_temp2(dsd_samples * 8 / fir1_decimation);
+	}
+	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		if (pcm_stages == 0) {
+			return dsd_fir1.run(dsd_data, pcm_data, dsd_samples);
+		}
+		real_t* pcm_inp = this->pcm_temp1;
+		real_t* pcm_out = this->pcm_temp2;
+		int pcm_samples = dsd_fir1.run(dsd_data, pcm_inp, dsd_samples);
+		for (int i = 0; i < pcm_stages; i++) {
+			pcm_samples = pcm_fir[i].run(pcm_inp, (i == pcm_stages - 1) ? pcm_data : pcm_out, pcm_samples);
+			real_t* pcm_tmp = pcm_inp;
+			pcm_inp = pcm_out;
+			pcm_out = pcm_tmp;
+		}
+		return pcm_samples;
+	}
+};
+
+/*
+* Two tones (997 and 1499 Hz) for the first half of the frames, different
+* pseudo-random data per channel after that, idle pattern for the last
+* quarter. Planar, frames * dsd_samples bytes per channel.
+*/
+void fill_channels(std::vector<uint8_t>& dsd_data, int frames, int dsd_samples, int dsd_samplerate) {
+	int tone_frames = frames / 2;
+	int silence_frames = frames / 4;
+	int noise_frames = frames - tone_frames - silence_frames;
+	bench_source_t source;
+	dsd_data.resize(VERIFY_CHANNELS * frames * dsd_samples);
+	for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+		uint8_t* ch_data = dsd_data.data() + ch * frames * dsd_samples;
+		source.fill_tone(ch_data, tone_frames * dsd_samples, 997.0 + 502.0 * ch, dsd_samplerate);
+		source.fill(ch_data + tone_frames * dsd_samples, noise_frames * dsd_samples);
+		memset(ch_data + (tone_frames + noise_frames) * dsd_samples, DSD_SILENCE_BYTE, silence_frames * dsd_samples);
+	}
+}
+
+bool is_silence(const uint8_t* dsd_data, int dsd_samples) {
+	for (int sample = 0; sample < dsd_samples; sample++) {
+		if (dsd_data[sample] != DSD_SILENCE_BYTE) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename real_t>
+DSDPCMConverter<real_t>* new_variant_converter(const verify_variant_t& variant, conv_type_e conv_type, int decimation) {
+	switch (variant.kind) {
+	case VERIFY_FFT:
+		return new DSDPCMConverterDirectFFT<real_t>(decimation);
+	case VERIFY_UNFUSED:
+		return new verify_unfused_t<real_t>(decimation);
+	case VERIFY_MULTIRATE:
+	{
+		int decimations[2] = { decimation, (decimation > 32) ? 16 : 64 };
+		return new DSDPCMConverterMultirate<real_t>(decimations, 2);
+	}
+	default:
+		return new_converter<real_t>(conv_type, decimation);
+	}
+}
+
+/*
+* One channel through a slot style converter. The time split variant hands
+* the second half of the frames to a fresh converter primed with the frames
+* covering its history, the silence variant repeats the settled level of idle
+* frames instead of converting them, both as the engine does.
+*/
+template<typename real_t>
+float run_channel(const verify_variant_t& variant, DSDPCMFilterSetup<real_t>& fltSetup, conv_type_e conv_type, int decimation, const uint8_t* dsd_data, int dsd_samples, int frames, std::vector<double>& pcm_out) {
+	double unit = DSDPCMSample<real_t>::get_unit();
+	int history_bytes = (fltSetup.get_fir1_64_length() + (PCMFIR2_2_LENGTH + PCMFIR3_2_LENGTH) * decimation) / 8 + 1;
+	int prime_frames = (history_bytes + dsd_samples - 1) / dsd_samples;
+	int split_frame = (variant.kind == VERIFY_SPLIT) ? ((frames / 2 > prime_frames) ? frames / 2 : prime_frames) : frames;
+	int silence_bytes = 0;
+	int silence_samples = 0;
+	real_t silence_level = 0;
+	DSDPCMConverter<real_t>* converter = new_variant_converter<real_t>(variant, conv_type, decimation);
+	DSDPCMConverter<real_t>* split_converter = nullptr;
+	converter->init(fltSetup, dsd_samples);
+	real_t* pcm_data = (real_t*)DSDPCMUtil::mem_alloc(2 * dsd_samples * sizeof(real_t));
+	for (int frame = 0; frame < frames; frame++) {
+		uint8_t* frame_data = (uint8_t*)dsd_data + frame * dsd_samples;
+		bool silent = variant.kind == VERIFY_SILENCE && is_silence(frame_data, dsd_samples);
+		int samples = 0;
+		if (silent && silence_bytes >= history_bytes && silence_samples > 0) {
+			for (int sample = 0; sample < silence_samples; sample++) {
+				pcm_data[sample] = silence_level;
+			}
+			samples = silence_samples;
+		}
+		else {
+			if (variant.kind == VERIFY_SPLIT && frame >= split_frame - prime_frames) {
+				if (!split_converter) {
+					split_converter = new_variant_converter<real_t>(variant, conv_type, decimation);
+					split_converter->init(fltSetup, dsd_samples);
+				}
+				samples = split_converter->convert(frame_data, pcm_data, dsd_samples);
+			}
+			if (frame < split_frame) {
+				samples = converter->convert(frame_data, pcm_data, dsd_samples);
+			}
+			if (!silent) {
+				silence_bytes = 0;
+			}
+			else {
+				if (silence_bytes < history_bytes) {
+					silence_bytes += dsd_samples;
+				}
+				if (silence_bytes >= history_bytes && samples > 0) {
+					silence_samples = samples;
+					silence_level = pcm_data[samples - 1];
+				}
+			}
+		}
+		if (variant.kind == VERIFY_MULTIRATE) {
+			samples = dsd_samples * 8 / decimation;
+		}
+		for (int sample = 0; sample < samples; sample++) {
+			pcm_out.push_back((double)pcm_data[sample] * unit);
+		}
+	}
+	float delay = converter->get_delay();
+	if (variant.kind == VERIFY_MULTIRATE) {
+		delay = ((DSDPCMConverterMultirate<real_t>*)converter)->get_delay(0);
+	}
+	DSDPCMUtil::mem_free(pcm_data);
+	delete split_converter;
+	delete converter;
+	return delay;
+}
+
+template<typename real_t>
+float run_variant(const verify_variant_t& variant, conv_type_e conv_type, int decimation, const uint8_t* dsd_data, int dsd_samples, int frames, std::vector<double>* pcm_out) {
+	DSDPCMFilterSetup<real_t> fltSetup;
+	fltSetup.set_ctables_layout(variant.radix, variant.fp32, variant.symmetric);
+	fltSetup.set_ctables_planes(variant.planes);
+	fltSetup.set_pcm_sum_fp64(variant.sum_fp64);
+	fltSetup.set_min_phase(conv_type == DSDPCM_CONV_LOWLATENCY);
+	double unit = DSDPCMSample<real_t>::get_unit();
+	if (variant.kind == VERIFY_LANES || variant.kind == VERIFY_LANES_SILENCE) {
+		DSDPCMConverterLanes<real_t> convLanes;
+		if (!convLanes.init(fltSetup, conv_type, decimation, VERIFY_CHANNELS, dsd_samples)) {
+			return -1.0f;
+		}
+		if (variant.kind == VERIFY_LANES_SILENCE) {
+			convLanes.set_silence_settle((fltSetup.get_fir1_64_length() + (PCMFIR2_2_LENGTH + PCMFIR3_2_LENGTH) * decimation) / 8 + 1);
+		}
+		for (int frame = 0; frame < frames; frame++) {
+			for (int sample = 0; sample < dsd_samples; sample++) {
+				for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+					convLanes.dsd_data[sample * VERIFY_CHANNELS + ch] = dsd_data[(ch * frames + frame) * dsd_samples + sample];
+				}
+			}
+			int samples = convLanes.convert(convLanes.dsd_data, convLanes.pcm_data, dsd_samples);
+			for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+				for (int sample = 0; sample < samples; sample++) {
+					pcm_out[ch].push_back((double)convLanes.pcm_data[sample * VERIFY_CHANNELS + ch] * unit);
+				}
+			}
+		}
+		return convLanes.get_delay();
+	}
+	float delay = 0.0f;
+	for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+		delay = run_channel<real_t>(variant, fltSetup, conv_type, decimation, dsd_data + ch * frames * dsd_samples, dsd_samples, frames, pcm_out[ch]);
+	}
+	return delay;
+}
+
+float run_variant(const verify_variant_t& variant, conv_type_e conv_type, int decimation, const uint8_t* dsd_data, int dsd_samples, int frames, std::vector<double>* pcm_out) {
+	switch (variant.precision) {
+	case 0:
+		return run_variant<int32_t>(variant, conv_type, decimation, dsd_data, dsd_samples, frames, pcm_out);
+	case 32:
+		return run_variant<float>(variant, conv_type, decimation, dsd_data, dsd_samples, frames, pcm_out);
+	default:
+		return run_variant<double>(variant, conv_type, decimation, dsd_data, dsd_samples, frames, pcm_out);
+	}
+}
+
+void compare(const std::vector<double>& ref_data, const std::vector<double>& var_data, int shift, verify_result_t& result) {
+	for (size_t i = 0; i + shift < var_data.size() && i < ref_data.size(); i++) {
+		double error = fabs(var_data[i + shift] - ref_data[i]);
+		if (error > result.max_error) {
+			result.max_error = error;
+		}
+		if (error > 0.0 && result.first_error < 0) {
+			result.first_error = (int64_t)i;
+		}
+		result.signal += ref_data[i] * ref_data[i];
+		result.noise += error * error;
+	}
+}
+
+const char* get_conv_name(conv_type_e conv_type) {
+	switch (conv_type) {
+	case DSDPCM_CONV_MULTISTAGE:
+		return "Multistage";
+	case DSDPCM_CONV_LOWLATENCY:
+		return "Min phase";
+	default:
+		return "Direct";
+	}
+}
+
+template<typename real_t>
+float run_polyphase(bool lanes, conv_type_e conv_type, int decimation, const uint8_t* dsd_data, int dsd_samples, int frames, std::vector<double>* pcm_out) {
+	DSDPCMFilterSetup<real_t> fltSetup;
+	fltSetup.set_min_phase(conv_type == DSDPCM_CONV_LOWLATENCY);
+	double unit = DSDPCMSample<real_t>::get_unit();
+	if (lanes) {
+		DSDPCMConverterLanes<real_t> convLanes;
+		if (!convLanes.init(fltSetup, conv_type, decimation, VERIFY_CHANNELS, dsd_samples, PCMxFs48_INTERPOLATION, PCMxFs48_DECIMATION)) {
+			return -1.0f;
+		}
+		for (int frame = 0; frame < frames; frame++) {
+			for (int sample = 0; sample < dsd_samples; sample++) {
+				for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+					convLanes.dsd_data[sample * VERIFY_CHANNELS + ch] = dsd_data[(ch * frames + frame) * dsd_samples + sample];
+				}
+			}
+			int samples = convLanes.convert(convLanes.dsd_data, convLanes.pcm_data, dsd_samples);
+			for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+				for (int sample = 0; sample < samples; sample++) {
+					pcm_out[ch].push_back((double)convLanes.pcm_data[sample * VERIFY_CHANNELS + ch] * unit);
+				}
+			}
+		}
+		return convLanes.get_delay();
+	}
+	float delay = 0.0f;
+	real_t* pcm_data = (real_t*)DSDPCMUtil::mem_alloc(2 * dsd_samples * 8 / decimation * sizeof(real_t));
+	for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+		DSDPCMConverterPolyphase<real_t> converter(new_converter<real_t>(conv_type, decimation), decimation, PCMxFs48_INTERPOLATION, PCMxFs48_DECIMATION);
+		converter.init(fltSetup, dsd_samples);
+		for (int frame = 0; frame < frames; frame++) {
+			int samples = converter.convert((uint8_t*)dsd_data + (ch * frames + frame) * dsd_samples, pcm_data, dsd_samples);
+			for (int sample = 0; sample < samples; sample++) {
+				pcm_out[ch].push_back((double)pcm_data[sample] * unit);
+			}
+		}
+		delay = converter.get_delay();
+	}
+	DSDPCMUtil::mem_free(pcm_data);
+	return delay;
+}
+
+int verify_polyphase(double tolerance, int frames) {
+	const char* names[] = { "fp32", "fixed", "lanes fp64", "lanes fp32", "lanes fixed" };
+	conv_type_e conv_types[] = { DSDPCM_CONV_MULTISTAGE, DSDPCM_CONV_LOWLATENCY };
+	int dsd_samples = DSDxFs64 / 8 / VERIFY_FRAMERATE;
+	std::vector<uint8_t> dsd_data;
+	fill_channels(dsd_data, frames, dsd_samples, DSDxFs64);
+	int failures = 0;
+	for (int t = 0; t < 2; t++) {
+		for (int decimation = 32; decimation <= 64; decimation *= 2) {
+			std::vector<double> ref_data[VERIFY_CHANNELS];
+			float ref_delay = run_polyphase<double>(false, conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, ref_data);
+			for (int v = 0; v < 5; v++) {
+				std::vector<double> var_data[VERIFY_CHANNELS];
+				float var_delay;
+				switch (v) {
+				case 0:
+					var_delay = run_polyphase<float>(false, conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, var_data);
+					break;
+				case 1:
+					var_delay = run_polyphase<int32_t>(false, conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, var_data);
+					break;
+				case 2:
+					var_delay = run_polyphase<double>(true, conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, var_data);
+					break;
+				case 3:
+					var_delay = run_polyphase<float>(true, conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, var_data);
+					break;
+				default:
+					var_delay = run_polyphase<int32_t>(true, conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, var_data);
+					break;
+				}
+				int shift = (int)floor(var_delay - ref_delay + 0.5f);
+				verify_result_t result;
+				for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+					compare(ref_data[ch], var_data[ch], shift, result);
+				}
+				bool failed = var_delay < 0.0f || result.max_error > tolerance;
+				failures += failed ? 1 : 0;
+				printf("Polyphase  %-10s x%-3d %-15s max %.3e  SNR %7.1f dB  %s\n",
+					get_conv_name(conv_types[t]),
+					decimation,
+					names[v],
+					result.max_error,
+					result.get_snr(),
+					failed ? "FAIL" : "ok"
+				);
+			}
+		}
+	}
+	return failures;
+}
+
+template<typename real_t>
+float run_downmix(conv_type_e conv_type, int decimation, const uint8_t* dsd_data, int dsd_samples, int frames, std::vector<double>* pcm_out) {
+	DSDPCMFilterSetup<real_t> fltSetup;
+	DSDPCMConverterLanes<real_t> convLanes;
+	double unit = DSDPCMSample<real_t>::get_unit();
+	convLanes.set_downmix(verify_downmix_matrix, VERIFY_CHANNELS, VERIFY_CHANNELS);
+	if (!convLanes.init(fltSetup, conv_type, decimation, VERIFY_CHANNELS, dsd_samples)) {
+		return -1.0f;
+	}
+	for (int frame = 0; frame < frames; frame++) {
+		for (int sample = 0; sample < dsd_samples; sample++) {
+			for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+				convLanes.dsd_data[sample * VERIFY_CHANNELS + ch] = dsd_data[(ch * frames + frame) * dsd_samples + sample];
+			}
+		}
+		int samples = convLanes.convert(convLanes.dsd_data, convLanes.pcm_data, dsd_samples);
+		for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+			for (int sample = 0; sample < samples; sample++) {
+				pcm_out[ch].push_back((double)convLanes.pcm_data[sample * VERIFY_CHANNELS + ch] * unit);
+			}
+		}
+	}
+	return convLanes.get_delay();
+}
+
+int verify_downmix(double tolerance, int frames) {
+	const char* names[] = { "fixed", "fp32", "fp64" };
+	conv_type_e conv_types[] = { DSDPCM_CONV_MULTISTAGE, DSDPCM_CONV_DIRECT };
+	int decimation = 64;
+	int dsd_samples = DSDxFs64 / 8 / VERIFY_FRAMERATE;
+	std::vector<uint8_t> dsd_data;
+	fill_channels(dsd_data, frames, dsd_samples, DSDxFs64);
+	int failures = 0;
+	for (int t = 0; t < 2; t++) {
+		std::vector<double> ref_data[VERIFY_CHANNELS];
+		float ref_delay = run_variant(verify_reference, conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, ref_data);
+		std::vector<double> mix_data[VERIFY_CHANNELS];
+		for (int och = 0; och < VERIFY_CHANNELS; och++) {
+			for (size_t i = 0; i < ref_data[0].size(); i++) {
+				double mix = 0.0;
+				for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+					mix += verify_downmix_matrix[och * VERIFY_CHANNELS + ch] * ref_data[ch][i];
+				}
+				mix_data[och].push_back(mix);
+			}
+		}
+		for (int precision = 0; precision < 3; precision++) {
+			std::vector<double> var_data[VERIFY_CHANNELS];
+			float var_delay;
+			switch (precision) {
+			case 0:
+				var_delay = run_downmix<int32_t>(conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, var_data);
+				break;
+			case 1:
+				var_delay = run_downmix<float>(conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, var_data);
+				break;
+			default:
+				var_delay = run_downmix<double>(conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, var_data);
+				break;
+			}
+			int shift = (int)floor(var_delay - ref_delay + 0.5f);
+			verify_result_t result;
+			for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+				compare(mix_data[ch], var_data[ch], shift, result);
+			}
+			bool failed = var_delay < 0.0f || result.max_error > tolerance;
+			failures += failed ? 1 : 0;
+			printf("Downmix    %-10s %-15s max %.3e  SNR %7.1f dB  %s\n",
+				conv_types[t] == DSDPCM_CONV_MULTISTAGE ? "Multistage" : "Direct",
+				names[precision],
+				result.max_error,
+				result.get_snr(),
+				failed ? "FAIL" : "ok"
+			);
+		}
+	}
+	return failures;
+}
+
+int verify_overload() {
+	const double pi = 3.14159265358979323846;
+	const int samples = 44100;
+	double levels[] = { 1.05, 1.5 };
+	int failures = 0;
+	for (double level : levels) {
+		std::vector<double> pcm_data(samples);
+		for (int sample = 0; sample < samples; sample++) {
+			double amplitude = (sample < samples / 2) ? level : 0.001;
+			pcm_data[sample] = amplitude * sin(2.0 * pi * 100.0 * (sample + 110) / 44100.0);
+		}
+		std::vector<uint8_t> out_data(2 * samples);
+		DSDPCMQuantizer quantizer;
+		quantizer.init(1, true, true);
+		quantizer.run<double>(DSDPCM_PCM_INT16, 0, pcm_data.data(), 1, samples, 1.0, out_data.data());
+		double max_error = 0.0;
+		for (int sample = 0; sample < samples; sample++) {
+			double clipped = pcm_data[sample] * 32768.0;
+			clipped = (clipped > 32767.0) ? 32767.0 : (clipped < -32768.0) ? -32768.0 : clipped;
+			int16_t value = (int16_t)(out_data[2 * sample] | (out_data[2 * sample + 1] << 8));
+			double error = fabs(value - clipped);
+			if (error > max_error) {
+				max_error = error;
+			}
+		}
+		bool failed = max_error > VERIFY_OVERLOAD_LSB;
+		failures += failed ? 1 : 0;
+		printf("Overload   %.2f  %-15s max %.1f LSB  %s\n", level, "int16 shaped", max_error, failed ? "FAIL" : "ok");
+	}
+	return failures;
+}
+
+static int32_t get_packed(const uint8_t* data, int bytes) {
+	uint32_t value = 0;
+	for (int i = 0; i < bytes; i++) {
+		value |= (uint32_t)data[i] << (8 * i);
+	}
+	return (int32_t)(value << (32 - 8 * bytes)) >> (32 - 8 * bytes);
+}
+
+static double get_band_power(const std::vector<double>& data, int bin_begin, int bin_end) {
+	const double pi = 3.14159265358979323846;
+	int n = (int)data.size();
+	double power = 0.0;
+	for (int bin = bin_begin; bin < bin_end; bin++) {
+		double re = 0.0;
+		double im = 0.0;
+		for (int i = 0; i < n; i++) {
+			double value = data[i] * (0.5 - 0.5 * cos(2.0 * pi * i / n));
+			re += value * cos(2.0 * pi * bin * i / n);
+			im -= value * sin(2.0 * pi * bin * i / n);
+		}
+		power += re * re + im * im;
+	}
+	return power / (bin_end - bin_begin);
+}
+
+int verify_quantizer() {
+	const double pi = 3.14159265358979323846;
+	const int samples = 4096;
+	int failures = 0;
+	pcm_format_e formats[] = { DSDPCM_PCM_INT24, DSDPCM_PCM_INT32 };
+	for (pcm_format_e format : formats) {
+		int bytes = DSDPCMQuantizer::get_sample_bytes(format);
+		double full_scale = (double)((int64_t)1 << (8 * bytes - 1));
+		double values[] = { 0.0, 0.5, -0.5, 0.25 + 3.0 / full_scale, -1.0 / full_scale, 2.4 / full_scale, 1.0, 1.5, -1.0, -1.5 };
+		int count = sizeof(values) / sizeof(*values);
+		std::vector<uint8_t> out_data(2 * bytes * count, 0xcc);
+		DSDPCMQuantizer quantizer;
+		quantizer.init(2, false, false);
+		quantizer.run<double>(format, 1, values, 1, count, 1.0, out_data.data());
+		bool failed = false;
+		for (int i = 0; i < count; i++) {
+			double expected = floor(values[i] * full_scale + 0.5);
+			expected = (expected > full_scale - 1.0) ? full_scale - 1.0 : (expected < -full_scale) ? -full_scale : expected;
+			const uint8_t* sample_data = out_data.data() + 2 * bytes * i;
+			for (int j = 0; j < bytes; j++) {
+				failed |= sample_data[j] != 0xcc;
+			}
+			failed |= get_packed(sample_data + bytes, bytes) != (int32_t)expected;
+		}
+		failures += failed ? 1 : 0;
+		printf("Quantizer  %-15s %-15s %s\n", bytes == 3 ? "int24" : "int32", "packing", failed ? "FAIL" : "ok");
+	}
+	pcm_format_e vector_formats[] = { DSDPCM_PCM_INT16, DSDPCM_PCM_INT24, DSDPCM_PCM_INT32 };
+	std::vector<float> vector_data(2 * samples + 1);
+	for (int sample = 0; sample < 2 * samples + 1; sample++) {
+		vector_data[sample] = (float)(1.2 * sin(2.0 * pi * 997.0 * sample / 44100.0));
+	}
+	for (pcm_format_e format : vector_formats) {
+		int bytes = DSDPCMQuantizer::get_sample_bytes(format);
+		std::vector<uint8_t> vector_out(2 * bytes * (samples + 1));
+		std::vector<uint8_t> scalar_out(2 * bytes * (samples + 1));
+		DSDPCMQuantizer vector_quantizer;
+		DSDPCMQuantizer scalar_quantizer;
+		vector_quantizer.init(2, true, false, true);
+		scalar_quantizer.init(2, true, false, false);
+		for (int ch = 0; ch < 2; ch++) {
+			vector_quantizer.run<float>(format, ch, vector_data.data() + ch, 2, samples, 1.0, vector_out.data());
+			scalar_quantizer.run<float>(format, ch, vector_data.data() + ch, 2, samples, 1.0, scalar_out.data());
+		}
+		bool failed = vector_out != scalar_out;
+		failures += failed ? 1 : 0;
+		printf("Quantizer  %-15s %-15s %s\n", bytes == 2 ? "int16" : bytes == 3 ? "int24" : "int32", "vector", failed ? "FAIL" : "ok");
+	}
+	std::vector<double> pcm_data(samples);
+	for (int sample = 0; sample < samples; sample++) {
+		pcm_data[sample] = 0.01 * sin(2.0 * pi * 997.0 * sample / 44100.0);
+	}
+	for (int shaped = 0; shaped < 2; shaped++) {
+		for (int dither = 0; dither < 2; dither++) {
+			if (shaped && !dither) {
+				continue;
+			}
+			std::vector<uint8_t> out_data(2 * samples);
+			DSDPCMQuantizer quantizer;
+			quantizer.init(1, dither != 0, shaped != 0);
+			quantizer.run<double>(DSDPCM_PCM_INT16, 0, pcm_data.data(), 1, samples, 1.0, out_data.data());
+			std::vector<double> error(samples);
+			double mean = 0.0;
+			double power = 0.0;
+			for (int sample = 0; sample < samples; sample++) {
+				error[sample] = get_packed(out_data.data() + 2 * sample, 2) - pcm_data[sample] * 32768.0;
+				mean += error[sample];
+				power += error[sample] * error[sample];
+			}
+			mean /= samples;
+			power /= samples;
+			bool failed;
+			if (shaped) {
+				double shaping = 10.0 * log10(get_band_power(error, samples * 7 / 16, samples / 2) / get_band_power(error, 1, samples / 16));
+				failed = !(shaping > VERIFY_SHAPING_DB);
+				printf("Quantizer  %-15s %-15s low band %5.1f dB down  %s\n", "int16", "shaped", shaping, failed ? "FAIL" : "ok");
+			}
+			else {
+				double expected = dither ? 0.25 : 1.0 / 12.0;
+				failed = fabs(power / expected - 1.0) > 0.1 || fabs(mean) > 0.05;
+				printf("Quantizer  %-15s %-15s error %.3f LSB^2  %s\n", "int16", dither ? "dither" : "plain", power, failed ? "FAIL" : "ok");
+			}
+			failures += failed ? 1 : 0;
+		}
+	}
+	return failures;
+}
+
+int main(int argc, char* argv[]) {
+	double tolerance = (argc > 1) ? atof(argv[1]) : 1e-5;
+	int frames = (argc > 2) ? atoi(argv[2]) : 8;
+	if (tolerance <= 0.0) {
+		tolerance = 1e-5;
+	}
+	if (frames < 2) {
+		frames = 2;
+	}
+	conv_type_e conv_types[] = { DSDPCM_CONV_MULTISTAGE, DSDPCM_CONV_DIRECT, DSDPCM_CONV_LOWLATENCY };
+	int failures = 0;
+	for (int t = 0; t < 3; t++) {
+		for (int decimation = 8; decimation <= 512; decimation *= 2) {
+			int dsd_samplerate = DSDxFs64 * (decimation > 64 ? decimation / 64 : 1);
+			int dsd_samples = dsd_samplerate / 8 / VERIFY_FRAMERATE;
+			std::vector<uint8_t> dsd_data;
+			fill_channels(dsd_data, frames, dsd_samples, dsd_samplerate);
+			std::vector<double> ref_data[VERIFY_CHANNELS];
+			float ref_delay = run_variant(verify_reference, conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, ref_data);
+			for (const verify_variant_t& variant : verify_variants) {
+				if (variant.kind == VERIFY_FFT && conv_types[t] != DSDPCM_CONV_DIRECT) {
+					continue;
+				}
+				if ((variant.kind == VERIFY_UNFUSED || variant.kind == VERIFY_MULTIRATE) && conv_types[t] == DSDPCM_CONV_DIRECT) {
+					continue;
+				}
+				std::vector<double>* base_data = ref_data;
+				float base_delay = ref_delay;
+				std::vector<double> plain_data[VERIFY_CHANNELS];
+				if (variant.is_exact()) {
+					verify_variant_t plain = variant;
+					plain.kind = (variant.kind == VERIFY_LANES_SILENCE) ? VERIFY_LANES : VERIFY_SLOT;
+					base_data = plain_data;
+					base_delay = run_variant(plain, conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, plain_data);
+				}
+				std::vector<double> var_data[VERIFY_CHANNELS];
+				float var_delay = run_variant(variant, conv_types[t], decimation, dsd_data.data(), dsd_samples, frames, var_data);
+				int shift = (int)floor(var_delay - base_delay + 0.5f);
+				verify_result_t result;
+				for (int ch = 0; ch < VERIFY_CHANNELS; ch++) {
+					compare(base_data[ch], var_data[ch], shift, result);
+				}
+				bool failed = var_delay < 0.0f || result.max_error > (variant.is_exact() ? 0.0 : tolerance);
+				failures += failed ? 1 : 0;
+				printf("%-10s x%-4d %-15s max %.3e  SNR %7.1f dB  first %8lld  %s\n",
+					get_conv_name(conv_types[t]),
+					decimation,
+					variant.name,
+					result.max_error,
+					result.get_snr(),
+					(long long)result.first_error,
+					failed ? "FAIL" : "ok"
+				);
+			}
+		}
+	}
+	failures += verify_polyphase(tolerance, frames);
+	failures += verify_downmix(tolerance, frames);
+	failures += verify_overload();
+	failures += verify_quantizer();
+	printf("%d failure(s), tolerance %.3e\n", failures, tolerance);
+	return failures > 0 ? 1 : 0;
+}
@@ -40,6 +40,7 @@ using namespace pfc;
 static const uint32_t UPDATE_STATS_MS = 500;
 static const int BITRATE_AVGS = 16;
 static const audio_sample PCM_OVERLOAD_THRESHOLD = 1.0f;
+static const char* DSDPCM_WISDOM_FILE = "foo_input_sacd_wisdom.txt";
 
 void console_fprintf(FILE* file, const char* fmt, ...) {
 	va_list vl;
@@ -116,16 +117,23 @@ conv_type_e get_converter_type() {
 	switch (CSACDPreferences::get_converter_mode()) {
 	case 0:
 	case 1:
+	case 8:
+	case 10:
 		conv_type = DSDPCM_CONV_MULTISTAGE;
 		break;
 	case 2:
 	case 3:
+	case 9:
 		conv_type = DSDPCM_CONV_DIRECT;
 		break;
 	case 4:
 	case 5:
 		conv_type = DSDPCM_CONV_USER;
 		break;
+	case 6:
+	case 7:
+		conv_type = DSDPCM_CONV_LOWLATENCY;
+		break;
 	}
 	return conv_type;
 }
@@ -136,27 +144,32 @@ bool get_converter_fp64() {
 	case 1:
 	case 3:
 	case 5:
+	case 7:
 		conv_fp64 = true;
 		break;
 	}
 	return conv_fp64;
 }
 
-void fix_pcm_stream(bool is_end, audio_sample* pcm_data, int pcm_samples, int pcm_channels) {
-	if (!is_end) {
-		if (pcm_samples > 1) {
-			for (int ch = 0; ch < pcm_channels; ch++) {
-				pcm_data[0 * pcm_channels + ch] = pcm_data[1 * pcm_channels + ch];
-			}
-		}
+bool get_converter_fixed() {
+	bool conv_fixed = false;
+	switch (CSACDPreferences::get_converter_mode()) {
+	case 8:
+	case 9:
+		conv_fixed = true;
+		break;
 	}
-	else {
-		if (pcm_samples > 1) {
-			for (int ch = 0; ch < pcm_channels; ch++) {
-				pcm_data[(pcm_samples - 1) * pcm_channels + ch] = pcm_data[(pcm_samples - 2) * pcm_channels + ch];
-			}
-		}
+	return conv_fixed;
+}
+
+bool get_converter_mixed() {
+	bool conv_mixed = false;
+	switch (CSACDPreferences::get_converter_mode()) {
+	case 10:
+		conv_mixed = true;
+		break;
 	}
+	return conv_mixed;
 }
 
 DSDPCMConverterEngine* g_dsdpcm_playback = nullptr;
@@ -192,8 +205,6 @@ class input_sacd_t {
 	int                    pcm_out_samplerate;
 	int                    pcm_out_bits_per_sample;
 	int                    pcm_out_samples;
-	float                  pcm_out_delay;
-	int                    pcm_out_delta;
 	uint64_t               pcm_out_offset;
 	int                    pcm_min_samplerate;
 	bool                   use_dsd_path;
@@ -446,6 +457,9 @@ public:
 		while ((pcm_min_samplerate / framerate) * framerate != pcm_min_samplerate) {
 			pcm_min_samplerate *= 2;
 		}
+		if (pcm_out_samplerate % DSDxFs1 != 0 && (pcm_out_samplerate % framerate != 0 || (pcm_out_samplerate / framerate) % PCMxFs48_INTERPOLATION != 0)) {
+			pcm_out_samplerate = pcm_out_samplerate / PCMxFs48_INTERPOLATION * PCMxFs48_DECIMATION;
+		}
 		pcm_out_samplerate = max(pcm_min_samplerate, pcm_out_samplerate);
 		pcm_out_samples = pcm_out_samplerate / framerate;
 		pcm_buf.set_size(pcm_out_channels * pcm_out_samples);
@@ -459,6 +473,7 @@ public:
 			fir_data = CSACDPreferences::get_user_fir().get_ptr();
 			fir_size = CSACDPreferences::get_user_fir().get_size();
 		}
+		conv_type_e conv_type = get_converter_type();
 		bool skip_init = false;
 		if (flags & input_flag_playback) {
 			dsdpcm_decoder = g_dsdpcm_playback;
@@ -470,9 +485,24 @@ public:
 			dsdpcm_convert = new DSDPCMConverterEngine();
 			dsdpcm_decoder = dsdpcm_convert;
 			skip_init = false;
+			if (conv_type == DSDPCM_CONV_LOWLATENCY) {
+				conv_type = DSDPCM_CONV_MULTISTAGE;
+			}
+		}
+		pfc::string8 wisdom_file = core_api::get_profile_path();
+		wisdom_file << "\\" << DSDPCM_WISDOM_FILE;
+		if (wisdom_file.find_first("file://") == 0) {
+			wisdom_file.remove_chars(0, 7);
 		}
+		dsdpcm_decoder->set_wisdom(wisdom_file, !(flags & input_flag_playback)); // no planning stall at the start of playback
 		dsdpcm_decoder->set_gain((float)CSACDPreferences::get_volume());
-		int rv = dsdpcm_decoder->init(pcm_out_channels, framerate, dsd_samplerate, pcm_out_samplerate, get_converter_type(), get_converter_fp64(), fir_data, fir_size, skip_init);
+		SYSTEM_INFO system_info;
+		GetSystemInfo(&system_info);
+		dsdpcm_decoder->set_exec_mode(((int)system_info.dwNumberOfProcessors < pcm_out_channels) ? DSDPCM_EXEC_LANES : DSDPCM_EXEC_THREADS);
+		dsdpcm_decoder->set_fixed_point(get_converter_fixed());
+		dsdpcm_decoder->set_mixed_precision(get_converter_mixed());
+		dsdpcm_decoder->set_delay_trim(!(flags & input_flag_playback));
+		int rv = dsdpcm_decoder->init(pcm_out_channels, framerate, dsd_samplerate, pcm_out_samplerate, conv_type, get_converter_fp64(), fir_data, fir_size, skip_init);
 		if (rv < 0) {
 			if (rv == -2) {
 				popup_message::g_show("No installed FIR, continue with the default", "DSD2PCM", popup_message::icon_error);
@@ -482,16 +512,6 @@ public:
 				throw exception_io();
 			}
 		}
-		if (flags & input_flag_playback) {
-			pcm_out_delay = 0.0f;
-		}
-		else {
-			pcm_out_delay = dsdpcm_decoder->get_delay();
-		}
-		pcm_out_delta = (int)(pcm_out_delay + 0.5f);
-		if (pcm_out_delta > pcm_out_samples - 1) {
-			pcm_out_delta = pcm_out_samples - 1;
-		}
 		track_completed = false;
 		excpt_cnt = 0;
 	}
@@ -541,16 +561,15 @@ public:
 							p_chunk.set_silence(pcm_min_samplerate / framerate);
 						}
 						else {
-							int remove_samples = dsdpcm_decoder->is_convert_called() ? 0 : pcm_out_delta;
-							dsdpcm_decoder->convert(dsd_data, dsd_size, pcm_buf.get_ptr());
-							if (remove_samples > 0) {
-								fix_pcm_stream(false, pcm_buf.get_ptr() + pcm_out_channels * remove_samples, pcm_out_samples - remove_samples, pcm_out_channels);
+							int pcm_samples = dsdpcm_decoder->convert_stream(dsd_data, dsd_size, pcm_buf.get_ptr()) / pcm_out_channels;
+							if (pcm_samples == 0) {
+								continue;
 							}
-							p_chunk.set_data(pcm_buf.get_ptr() + pcm_out_channels * remove_samples, pcm_out_samples - remove_samples, pcm_out_channels, pcm_out_samplerate, pcm_out_channel_map);
+							p_chunk.set_data(pcm_buf.get_ptr(), pcm_samples, pcm_out_channels, pcm_out_samplerate, pcm_out_channel_map);
 							if (log_overloads) {
-								decode_check_overloads(pcm_buf.get_ptr() + pcm_out_channels * remove_samples, pcm_out_samples - remove_samples);
+								decode_check_overloads(pcm_buf.get_ptr(), pcm_samples);
 							}
-							pcm_out_offset += pcm_out_samples - remove_samples;
+							pcm_out_offset += pcm_samples;
 						}
 						return true;
 					}
@@ -561,6 +580,7 @@ public:
 			}
 		}
 		dsd_data = nullptr;
+		dsd_size = 0;
 		dst_data = nullptr;
 		dst_size = 0;
 		if (dst_decoder) {
@@ -579,32 +599,25 @@ public:
 			}
 		}
 		else {
-			if (dsd_size > 0) {
-				dsdpcm_decoder->convert(dsd_data, dsd_size, pcm_buf.get_ptr());
-				p_chunk.set_data(pcm_buf.get_ptr(), pcm_out_samples, pcm_out_channels, pcm_out_samplerate, pcm_out_channel_map);
+			int pcm_samples = 0;
+			if (dsd_data && dsd_size > 0) {
+				pcm_samples = dsdpcm_decoder->convert_stream(dsd_data, dsd_size, pcm_buf.get_ptr()) / pcm_out_channels;
+			}
+			if (pcm_samples == 0 && !(flags & input_flag_playback)) {
+				// The short last frame and the trimmed converter delay are flushed with the ring-out
+				pcm_samples = dsdpcm_decoder->convert_stream(nullptr, 0, pcm_buf.get_ptr()) / pcm_out_channels;
+			}
+			if (pcm_samples > 0) {
+				p_chunk.set_data(pcm_buf.get_ptr(), pcm_samples, pcm_out_channels, pcm_out_samplerate, pcm_out_channel_map);
 				if (log_overloads) {
-					decode_check_overloads(pcm_buf.get_ptr(), pcm_out_samples);
+					decode_check_overloads(pcm_buf.get_ptr(), pcm_samples);
 				}
-				pcm_out_offset += pcm_out_samples;
+				pcm_out_offset += pcm_samples;
 				return true;
 			}
 			if (flags & input_flag_playback) {
 				g_track_completed = true;
 			}
-			else {
-				int append_samples = pcm_out_delta;
-				if (append_samples > 0) {
-					dsdpcm_decoder->convert(nullptr, 0, pcm_buf.get_ptr());
-					fix_pcm_stream(true, pcm_buf.get_ptr(), append_samples, pcm_out_channels);
-					p_chunk.set_data(pcm_buf.get_ptr(), append_samples, pcm_out_channels, pcm_out_samplerate, pcm_out_channel_map);
-					if (log_overloads) {
-						decode_check_overloads(pcm_buf.get_ptr(), append_samples);
-					}
-				}
-				pcm_out_offset += append_samples;
-				track_completed = true;
-				return true;
-			}
 			track_completed = true;
 		}
 		return false;
@@ -665,6 +678,10 @@ public:
 		if (!sacd_reader->seek(p_seconds)) {
 			throw exception_io();
 		}
+		if (dsdpcm_decoder) {
+			dsdpcm_decoder->reset_stream();
+		}
+		track_completed = false;
 	}
 
 	bool decode_can_seek() {
@@ -98,6 +98,8 @@ service_ptr_t<output_entry> proxy_output_t::g_get_output() {
 
 proxy_output_t::proxy_output_t(const GUID& p_device, double p_buffer_length, bool p_dither, t_uint32 p_bitdepth) {
 	m_stream_type = stream_type_e::BAD;
+	m_dsd_reduce = false;
+	m_dsd_block = 0;
 	m_volume = 0;
 	m_duration = 0;
 	m_trace = CSACDPreferences::g_get_trace();
@@ -156,6 +158,8 @@ void proxy_output_t::process_samples(const audio_chunk& p_chunk) {
 		m_dop_marker_n.set_size(0);
 		volume_adjust();
 		m_spec = spec;
+		m_dsd_block = dsd_chunk ? dsd_chunk->get_samples() : 0;
+		init_dsd_reducer();
 		m_duration = 0;
 		if (m_trace) {
 			print_stream_type();
@@ -200,6 +204,7 @@ void proxy_output_t::pause(bool p_state) {
 
 void proxy_output_t::flush() {
 	m_audio_stream->flush();
+	init_dsd_reducer();
 	m_output->flush();
 	if (m_trace) {
 		console::printf("proxy_output::flush()");
@@ -208,6 +213,7 @@ void proxy_output_t::flush() {
 
 void proxy_output_t::flush_changing_track() {
 	m_audio_stream->flush();
+	init_dsd_reducer();
 	if (m_is_output_v2) {
 		m_output_v2->flush_changing_track();
 	}
@@ -273,6 +279,12 @@ void proxy_output_t::pack_dsd_to_dop(t_samplespec& p_spec) {
 		spec.m_channel_config = p_spec.m_channel_config;
 	}
 	uint8_t* dsd_data = static_cast<uint8_t*>(dsd_chunk->get_data());
+	if (m_dsd_reduce) {
+		m_dsd_reduced.set_size(dsd_channels * (dsd_samples / m_dsd_reducer.get_ratio() + DSDDSD_INTERPOLATION / 8));
+		dsd_samples = m_dsd_reducer.convert(dsd_data, m_dsd_reduced.get_ptr(), (int)dsd_samples);
+		dsd_data = m_dsd_reduced.get_ptr();
+		spec.m_sample_rate = DSDxFs64;
+	}
 	unsigned dop_samplerate = spec.m_sample_rate / 16;
 	t_size dop_channels = spec.m_channels;
 	t_size dop_samples = dsd_samples / 2;
@@ -302,6 +314,16 @@ void proxy_output_t::pack_dsd_to_dop(t_samplespec& p_spec) {
 	m_audio_stream->remove_first_chunk();
 }
 
+void proxy_output_t::init_dsd_reducer() {
+	m_dsd_reduce = false;
+	if (m_stream_type == stream_type_e::DSD && CSACDPreferences::get_output_mode() == 2 && m_spec.m_sample_rate > DSDxFs64 && m_dsd_block > 0) {
+		m_dsd_reduce = m_dsd_reducer.init(m_spec.m_channels, m_spec.m_sample_rate, DSDxFs64, (int)m_dsd_block);
+		if (m_trace) {
+			console::printf("DSD stream reduced to DSD64: %s", m_dsd_reduce ? "yes" : "no");
+		}
+	}
+}
+
 void proxy_output_t::volume_adjust() {
 	switch (m_stream_type) {
 	case stream_type_e::DSD:
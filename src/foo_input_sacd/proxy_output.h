@@ -22,12 +22,17 @@
 #include <windows.h>
 #include <foobar2000.h>
 #include "audio_stream.h"
+#include "DSDDSDConverter.h"
 
 class proxy_output_t : public output_v2 {
 	static const uint8_t DoP_MARKER[2];
 	pfc::array_t<t_size> m_dop_marker_n;
 	pfc::array_t<uint8_t> m_dop_data;
 	audio_chunk_impl m_dop_chunk;
+	DSDDSDConverter<float> m_dsd_reducer;
+	pfc::array_t<uint8_t> m_dsd_reduced;
+	bool m_dsd_reduce;
+	t_size m_dsd_block;
 	static_api_ptr_t<audio_stream_t> m_audio_stream;
 	service_ptr_t<output> m_output;
 	t_samplespec m_spec;
@@ -61,6 +66,7 @@ public:
 	virtual void on_track_mark();
 	virtual void enable_fading(bool p_state);
 private:
+	void init_dsd_reducer();
 	void pack_dsd_to_dop(t_samplespec& p_spec);
 	void volume_adjust();
 	void print_stream_type();
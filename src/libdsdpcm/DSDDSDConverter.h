@@ -0,0 +1,208 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "DSDPCMConverterLanes.h"
+
+#define DSDDSD_INTERPOLATION 32
+#define DSDDSD_TAPS          16
+#define DSDDSD_SDM_LANES     8
+#define DSDDSD_SDM_SECTIONS  4
+#define DSDDSD_SDM_GAIN      0.84
+#define DSDDSD_SDM_INPUT     0.6
+#define DSDDSD_SDM_LIMIT     8.0
+
+/*
+* 7th order noise transfer function, OSR 64, max |NTF| 1.4: optimal (Legendre)
+* zeros, Butterworth highpass poles. Sections are { b1, b2, a1, a2 } with
+* b0 = a0 = 1, the first one is first order. The loop is stable up to 0.6
+* input. The input is scaled by DSDDSD_SDM_GAIN (-1.5 dB), which brings the
+* SACD peak level (+3.1 dB, 0.714) down to that; the reduced stream plays
+* 1.5 dB softer than the source. Only out of spec peaks are still clipped,
+* to keep the loop stable.
+*/
+static const double DSDDSD_SDM_SOS[DSDDSD_SDM_SECTIONS][4] = {
+	{ -1,                  0, -0.86022455695524447, 0                   },
+	{ -1.9996031319316019, 1, -1.742888323720226,   0.76268031466113684 },
+	{ -1.9986751988816913, 1, -1.8089975676850263,  0.8295402857608053  },
+	{ -1.9978298366295812, 1, -1.9139017236773135,  0.93563571836950321 },
+};
+
+/*
+* DSD to DSD rate reducer (DSD512/256/128 -> DSD64 and alike). The input runs
+* through the multistage cascade down to 1/32 of the output rate (88.2 kHz for
+* DSD64, which drops the shaped noise of the source), is interpolated by 32
+* and re-modulated by an error feedback sigma-delta modulator. The
+* interpolator is short, its images land above 80 kHz under the shaped noise
+* of the output. The modulator keeps its state in DSDDSD_SDM_LANES wide arrays
+* and loops over the channels innermost, so all channels are computed in
+* parallel by vector instructions. Floating point real_t only.
+*/
+
+template<typename real_t>
+class DSDDSDConverter {
+	int      channels;
+	int      ratio;
+	int      granule;
+	int      dsd_samples;
+	float    delay;
+	DSDPCMFilterSetup<real_t>    flt_setup;
+	DSDPCMConverterLanes<real_t>* conv_lanes;
+	uint8_t* dsd_rest;
+	int      rest_samples;
+	double   sdm_s1[DSDDSD_SDM_SECTIONS][DSDDSD_SDM_LANES];
+	double   sdm_s2[DSDDSD_SDM_SECTIONS][DSDDSD_SDM_LANES];
+public:
+	DSDDSDConverter() {
+		channels = 0;
+		ratio = 0;
+		granule = 0;
+		dsd_samples = 0;
+		delay = 0.0f;
+		conv_lanes = nullptr;
+		dsd_rest = nullptr;
+		rest_samples = 0;
+	}
+	~DSDDSDConverter() {
+		delete conv_lanes;
+		DSDPCMUtil::mem_free(dsd_rest);
+	}
+	int get_ratio() {
+		return ratio;
+	}
+	float get_delay() {
+		return delay;
+	}
+	bool init(int channels, int dsd_samplerate, int out_samplerate, int dsd_samples) {
+		if (channels < 1 || channels > DSDDSD_SDM_LANES || out_samplerate < DSDxFs64 || dsd_samplerate % out_samplerate != 0) {
+			return false;
+		}
+		this->channels = channels;
+		this->ratio = dsd_samplerate / out_samplerate;
+		this->granule = DSDDSD_INTERPOLATION / 8 * ratio;
+		this->dsd_samples = dsd_samples / granule * granule;
+		delete conv_lanes;
+		conv_lanes = new DSDPCMConverterLanes<real_t>();
+		if (!conv_lanes->init(flt_setup, DSDPCM_CONV_MULTISTAGE, DSDDSD_INTERPOLATION * ratio, channels, this->dsd_samples, DSDDSD_INTERPOLATION, 1, DSDDSD_TAPS)) {
+			delete conv_lanes;
+			conv_lanes = nullptr;
+			return false;
+		}
+		delay = conv_lanes->get_delay();
+		DSDPCMUtil::mem_free(dsd_rest);
+		dsd_rest = (uint8_t*)DSDPCMUtil::mem_alloc(granule * channels);
+		rest_samples = 0;
+		memset(sdm_s1, 0, sizeof(sdm_s1));
+		memset(sdm_s2, 0, sizeof(sdm_s2));
+		return true;
+	}
+	/*
+	* Takes interleaved DSD (dsd_samples bytes per channel) and returns the
+	* number of bytes per channel written to out_data, at most
+	* dsd_samples / ratio + DSDDSD_INTERPOLATION / 8. Input short of a whole granule of the
+	* cascade is kept for the next call.
+	*/
+	int convert(uint8_t* dsd_data, uint8_t* out_data, int dsd_samples) {
+		int out_samples = 0;
+		if (rest_samples > 0) {
+			int rest_fill = (granule - rest_samples < dsd_samples) ? granule - rest_samples : dsd_samples;
+			memcpy(dsd_rest + rest_samples * channels, dsd_data, rest_fill * channels);
+			rest_samples += rest_fill;
+			dsd_data += rest_fill * channels;
+			dsd_samples -= rest_fill;
+			if (rest_samples < granule) {
+				return 0;
+			}
+			rest_samples = 0;
+			out_samples += convert_block(dsd_rest, out_data, granule);
+		}
+		while (dsd_samples >= granule) {
+			int samples = (dsd_samples < this->dsd_samples) ? dsd_samples / granule * granule : this->dsd_samples;
+			out_samples += convert_block(dsd_data, out_data + out_samples * channels, samples);
+			dsd_data += samples * channels;
+			dsd_samples -= samples;
+		}
+		memcpy(dsd_rest, dsd_data, dsd_samples * channels);
+		rest_samples = dsd_samples;
+		return out_samples;
+	}
+private:
+	int convert_block(uint8_t* dsd_data, uint8_t* out_data, int dsd_samples) {
+		memcpy(conv_lanes->dsd_data, dsd_data, dsd_samples * channels);
+		int pcm_samples = conv_lanes->convert(conv_lanes->dsd_data, conv_lanes->pcm_data, dsd_samples);
+		modulate(conv_lanes->pcm_data, out_data, pcm_samples / 8);
+		return pcm_samples / 8;
+	}
+	void modulate(const real_t* pcm_data, uint8_t* out_data, int out_samples) {
+		double s1[DSDDSD_SDM_SECTIONS][DSDDSD_SDM_LANES];
+		double s2[DSDDSD_SDM_SECTIONS][DSDDSD_SDM_LANES];
+		double u[DSDDSD_SDM_LANES] = { 0 };
+		double x[DSDDSD_SDM_LANES];
+		double v[DSDDSD_SDM_LANES];
+		int    out_byte[DSDDSD_SDM_LANES];
+		memcpy(s1, sdm_s1, sizeof(s1));
+		memcpy(s2, sdm_s2, sizeof(s2));
+		for (int sample = 0; sample < out_samples; sample++) {
+			for (int ch = 0; ch < DSDDSD_SDM_LANES; ch++) {
+				out_byte[ch] = 0;
+			}
+			for (int bit = 0; bit < 8; bit++) {
+				for (int ch = 0; ch < channels; ch++) {
+					double in = DSDDSD_SDM_GAIN * (double)pcm_data[ch];
+					u[ch] = (in < -DSDDSD_SDM_INPUT) ? -DSDDSD_SDM_INPUT : (in > DSDDSD_SDM_INPUT) ? DSDDSD_SDM_INPUT : in;
+				}
+				pcm_data += channels;
+				for (int ch = 0; ch < DSDDSD_SDM_LANES; ch++) {
+					x[ch] = u[ch];
+				}
+				for (int k = 0; k < DSDDSD_SDM_SECTIONS; k++) {
+					for (int ch = 0; ch < DSDDSD_SDM_LANES; ch++) {
+						x[ch] += s1[k][ch];
+					}
+				}
+				for (int ch = 0; ch < DSDDSD_SDM_LANES; ch++) {
+					int y = x[ch] >= 0.0;
+					out_byte[ch] = (out_byte[ch] << 1) | y;
+					v[ch] = (y ? 1.0 : -1.0) - x[ch];
+				}
+				for (int k = 0; k < DSDDSD_SDM_SECTIONS; k++) {
+					const double* sos = DSDDSD_SDM_SOS[k];
+					for (int ch = 0; ch < DSDDSD_SDM_LANES; ch++) {
+						double w = v[ch] + s1[k][ch];
+						s1[k][ch] = sos[0] * v[ch] - sos[2] * w + s2[k][ch];
+						s2[k][ch] = sos[1] * v[ch] - sos[3] * w;
+						v[ch] = w;
+					}
+				}
+			}
+			for (int ch = 0; ch < channels; ch++) {
+				out_data[ch] = (uint8_t)out_byte[ch];
+				if (!(fabs(x[ch]) < DSDDSD_SDM_LIMIT)) {
+					for (int k = 0; k < DSDDSD_SDM_SECTIONS; k++) {
+						s1[k][ch] = s2[k][ch] = 0.0;
+					}
+				}
+			}
+			out_data += channels;
+		}
+		memcpy(sdm_s1, s1, sizeof(s1));
+		memcpy(sdm_s2, s2, sizeof(s2));
+	}
+};
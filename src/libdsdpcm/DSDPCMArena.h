@@ -0,0 +1,170 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <stdint.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "DSDPCMConstants.h"
+
+enum arena_pages_e {
+	DSDPCM_PAGES_NORMAL      = 0,
+	DSDPCM_PAGES_TRANSPARENT = 1,
+	DSDPCM_PAGES_EXPLICIT    = 2
+};
+
+/*
+* Bump allocator over page mapped regions. While an arena is current on a
+* thread, DSDPCMUtil::mem_alloc takes its memory from it, mem_free of that
+* memory does nothing and release() unmaps everything at once. Regions come
+* zeroed from the system. Transparent huge pages are requested by madvise,
+* explicit ones by MAP_HUGETLB (MEM_LARGE_PAGES on Windows, which needs the
+* lock pages privilege); both fall back to normal pages.
+*/
+
+class DSDPCMArena {
+	struct region_t {
+		region_t* next;
+		size_t    size;
+		size_t    used;
+	};
+	region_t*     regions;
+	arena_pages_e pages;
+public:
+	DSDPCMArena() {
+		regions = nullptr;
+		pages = DSDPCM_PAGES_NORMAL;
+	}
+	~DSDPCMArena() {
+		release();
+	}
+	arena_pages_e get_pages() {
+		return pages;
+	}
+	void set_pages(arena_pages_e pages) {
+		this->pages = pages;
+	}
+	void* alloc(size_t size) {
+		size = (size + MEM_ALIGN - 1) & ~(size_t)(MEM_ALIGN - 1);
+		if (!regions || regions->used + size > regions->size) {
+			size_t region_size = MEM_ALIGN + size;
+			region_t* region = (region_t*)map(region_size, pages);
+			if (!region) {
+				return nullptr;
+			}
+			region->size = region_size;
+			region->used = MEM_ALIGN;
+			if (regions && region_size - MEM_ALIGN - size < regions->size - regions->used) {
+				region->next = regions->next;
+				regions->next = region;
+			}
+			else {
+				region->next = regions;
+				regions = region;
+			}
+			uint8_t* memory = (uint8_t*)region + region->used;
+			region->used += size;
+			return memory;
+		}
+		uint8_t* memory = (uint8_t*)regions + regions->used;
+		regions->used += size;
+		return memory;
+	}
+	void release() {
+		while (regions) {
+			region_t* next = regions->next;
+			unmap(regions, regions->size);
+			regions = next;
+		}
+	}
+	size_t get_bytes() {
+		size_t bytes = 0;
+		for (region_t* region = regions; region; region = region->next) {
+			bytes += region->size;
+		}
+		return bytes;
+	}
+	static DSDPCMArena*& current() {
+		static thread_local DSDPCMArena* arena = nullptr;
+		return arena;
+	}
+	static void* map(size_t& size, arena_pages_e pages) {
+		size = (size + DSDPCM_ARENA_REGION - 1) & ~(size_t)(DSDPCM_ARENA_REGION - 1);
+#ifdef _WIN32
+		void* memory = nullptr;
+		if (pages == DSDPCM_PAGES_EXPLICIT) {
+			size_t large_page = GetLargePageMinimum();
+			if (large_page > 0) {
+				size_t large_size = (size + large_page - 1) & ~(large_page - 1);
+				memory = VirtualAlloc(nullptr, large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				if (memory) {
+					size = large_size;
+				}
+			}
+		}
+		if (!memory) {
+			memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		}
+		return memory;
+#else
+		void* memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		if (pages == DSDPCM_PAGES_EXPLICIT) {
+			memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		}
+#endif
+		if (memory == MAP_FAILED) {
+			memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (memory == MAP_FAILED) {
+				return nullptr;
+			}
+#ifdef MADV_HUGEPAGE
+			if (pages != DSDPCM_PAGES_NORMAL) {
+				madvise(memory, size, MADV_HUGEPAGE);
+			}
+#endif
+		}
+		return memory;
+#endif
+	}
+	static void unmap(void* memory, size_t size) {
+#ifdef _WIN32
+		VirtualFree(memory, 0, MEM_RELEASE);
+#else
+		munmap(memory, size);
+#endif
+	}
+};
+
+class DSDPCMArenaScope {
+	DSDPCMArena* saved;
+public:
+	DSDPCMArenaScope(DSDPCMArena* arena) {
+		saved = DSDPCMArena::current();
+		DSDPCMArena::current() = arena;
+	}
+	~DSDPCMArenaScope() {
+		DSDPCMArena::current() = saved;
+	}
+};
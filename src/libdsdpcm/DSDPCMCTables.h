@@ -0,0 +1,350 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "DSDPCMConstants.h"
+#include "DSDPCMUtil.h"
+#include "DSDPCMSample.h"
+#include "DSDPCMCTablesDefault.h"
+
+class DSDPCMCTables {
+public:
+	int   radix;
+	int   size;
+	int   count;
+	int   mirrors;
+	int   fir_length;
+	bool  fp32;
+	bool  fixed;
+	int   entry_size;
+	int   planes;
+	int   words;
+	double  plane_step;
+	int64_t plane_sum;
+	float fir_delay;
+	void* data;
+	bool  data_static;
+	uint8_t swap_bits[256];
+	DSDPCMCTables(int fir_length, int radix, bool symmetric, bool fp32, size_t real_size, bool fixed, int planes) {
+		this->radix = radix;
+		this->size = 1 << radix;
+		this->fir_length = fir_length;
+		this->mirrors = symmetric ? fir_length / (2 * radix) : 0;
+		this->count = mirrors + CTABLES_RADIX(fir_length - 2 * radix * mirrors, radix);
+		this->fp32 = fp32 && !fixed;
+		this->fixed = fixed;
+		this->entry_size = fixed ? sizeof(int32_t) : fp32 ? sizeof(float) : (int)real_size;
+		this->planes = planes;
+		this->words = planes > 0 ? (CTABLES(fir_length) + 7) / 8 : 0;
+		this->plane_step = 0.0;
+		this->plane_sum = 0;
+		this->fir_delay = (float)(fir_length - 1) / 2;
+		this->data = DSDPCMUtil::mem_alloc_pages(get_bytes(), DSDPCMArena::current() ? DSDPCMArena::current()->get_pages() : DSDPCM_PAGES_NORMAL);
+		this->data_static = false;
+		init_swap_bits();
+	}
+	DSDPCMCTables(const void* static_data, int fir_length, bool fp32) {
+		this->radix = 8;
+		this->size = 256;
+		this->fir_length = fir_length;
+		this->mirrors = 0;
+		this->count = CTABLES(fir_length);
+		this->fp32 = fp32;
+		this->fixed = false;
+		this->entry_size = fp32 ? sizeof(float) : sizeof(double);
+		this->planes = 0;
+		this->words = 0;
+		this->plane_step = 0.0;
+		this->plane_sum = 0;
+		this->fir_delay = (float)(fir_length - 1) / 2;
+		this->data = const_cast<void*>(static_data);
+		this->data_static = true;
+		init_swap_bits();
+	}
+	~DSDPCMCTables() {
+		if (!data_static) {
+			DSDPCMUtil::mem_free(data);
+		}
+	}
+	template<typename table_t> table_t* get(int ct) {
+		return (table_t*)data + (size_t)ct * size;
+	}
+	size_t get_bytes() {
+		if (planes > 0) {
+			return (size_t)words * planes * sizeof(uint64_t);
+		}
+		return (size_t)count * size * entry_size;
+	}
+	int get_mirror_offset(int ct) {
+		return fir_length - radix - ct * radix;
+	}
+	int get_mirror_index(const uint8_t* dsd_data, int stride, int ct) {
+		int bit_offset = get_mirror_offset(ct);
+		if (radix == 8 && (bit_offset & 7) == 0) {
+			return swap_bits[dsd_data[(bit_offset >> 3) * stride]];
+		}
+		int index = get_index(dsd_data, stride, bit_offset, radix);
+		index = ((int)swap_bits[index & 0xff] << 8) | swap_bits[(index >> 8) & 0xff];
+		return index >> (16 - radix);
+	}
+	void set_ctables(const double* fir_coefs, const int fir_length, const double fir_gain) {
+		fir_delay = DSDPCMUtil::get_fir_delay(fir_coefs, fir_length);
+		if (planes > 0) {
+			set_planes(fir_coefs, fir_length, fir_gain);
+		}
+		else if (fixed) {
+			set_ctables<int32_t>(fir_coefs, fir_length, fir_gain);
+		}
+		else if (entry_size == sizeof(float)) {
+			set_ctables<float>(fir_coefs, fir_length, fir_gain);
+		}
+		else {
+			set_ctables<double>(fir_coefs, fir_length, fir_gain);
+		}
+	}
+	static int get_index(const uint8_t* dsd_data, int stride, int bit_offset, int radix) {
+		const uint8_t* p = dsd_data + (bit_offset >> 3) * stride;
+		uint32_t bits = ((uint32_t)p[0] << 16) | ((uint32_t)p[stride] << 8) | (uint32_t)p[2 * stride];
+		return (int)((bits >> (24 - (bit_offset & 7) - radix)) & ((1u << radix) - 1));
+	}
+	/*
+	* Bit-plane sum of a window of words bytes: S = sum of the quantized
+	* coefficients under set DSD bits, the top plane weighing negative. The
+	* FIR output is (2 * S - plane_sum) * plane_step.
+	*/
+	double get_plane_value(const uint64_t* window) {
+		const uint64_t* plane_words = (const uint64_t*)data;
+		int64_t counts[64] = { 0 };
+		for (int w = 0; w < words; w++) {
+			uint64_t bits = window[w];
+			const uint64_t* plane = plane_words + (size_t)w * planes;
+			for (int p = 0; p < planes; p++) {
+				counts[p] += DSDPCMUtil::popcount(bits & plane[p]);
+			}
+		}
+		int64_t sum = -(counts[planes - 1] << (planes - 1));
+		for (int p = 0; p < planes - 1; p++) {
+			sum += counts[p] << p;
+		}
+		return (double)(2 * sum - plane_sum) * plane_step;
+	}
+	static bool is_symmetric(const double* fir_coefs, int fir_length) {
+		for (int i = 0; i < fir_length / 2; i++) {
+			if (fir_coefs[i] != fir_coefs[fir_length - 1 - i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+private:
+	void init_swap_bits() {
+		for (int i = 0; i < 256; i++) {
+			swap_bits[i] = 0;
+			for (int j = 0; j < 8; j++) {
+				swap_bits[i] |= ((i >> j) & 1) << (7 - j);
+			}
+		}
+	}
+	void set_planes(const double* fir_coefs, const int fir_length, const double fir_gain) {
+		double coef_max = 0.0;
+		for (int i = 0; i < fir_length; i++) {
+			coef_max = (fabs(fir_coefs[i] * fir_gain) > coef_max) ? fabs(fir_coefs[i] * fir_gain) : coef_max;
+		}
+		plane_step = (coef_max > 0.0) ? coef_max / (double)(((int64_t)1 << (planes - 1)) - 1) : 1.0;
+		plane_sum = 0;
+		std::vector<uint8_t> plane_bytes((size_t)planes * words * 8, 0);
+		for (int n = 0; n < fir_length; n++) {
+			int64_t coef = llround(fir_coefs[fir_length - 1 - n] * fir_gain / plane_step);
+			plane_sum += coef;
+			for (int p = 0; p < planes; p++) {
+				if (((uint64_t)coef >> p) & 1) {
+					plane_bytes[(size_t)p * words * 8 + n / 8] |= 0x80 >> (n & 7);
+				}
+			}
+		}
+		uint64_t* plane_words = (uint64_t*)data;
+		for (int w = 0; w < words; w++) {
+			for (int p = 0; p < planes; p++) {
+				memcpy(&plane_words[(size_t)w * planes + p], &plane_bytes[((size_t)p * words + w) * 8], sizeof(uint64_t));
+			}
+		}
+	}
+	template<typename table_t>
+	void set_ctables(const double* fir_coefs, const int fir_length, const double fir_gain) {
+		int fir_limit = fir_length - radix * mirrors;
+		for (int ct = 0; ct < count; ct++) {
+			int k = fir_limit - ct * radix;
+			if (k > radix) {
+				k = radix;
+			}
+			if (k < 0) {
+				k = 0;
+			}
+			table_t* ctable = get<table_t>(ct);
+			for (int i = 0; i < size; i++) {
+				double cvalue = 0.0;
+				for (int j = 0; j < k; j++) {
+					cvalue += (((i >> (radix - 1 - j)) & 1) * 2 - 1) * fir_coefs[fir_length - 1 - (ct * radix + j)];
+				}
+				ctable[i] = DSDPCMSample<table_t>::make_value(cvalue * fir_gain);
+			}
+		}
+	}
+};
+
+/*
+* Process-wide cache of DSD FIR lookup tables. Filter setups of all engines
+* (playback, converters, scanners) attach to the same table set as long as
+* coefficients, gain, radix, symmetry and entry precision match. Radix 8
+* tables of the built-in FIRs come from the compile-time default set.
+* Bit-plane sets only match bit-plane sets of the same depth.
+*/
+
+class DSDPCMCTablesCache {
+	class Entry {
+	public:
+		std::vector<double> fir_coefs;
+		double         fir_gain;
+		int            radix;
+		bool           symmetric;
+		bool           fixed;
+		int            entry_size;
+		int            planes;
+		int            refs;
+		DSDPCMCTables* ctables;
+	};
+	std::vector<Entry> entries;
+	std::mutex         entries_lock;
+public:
+	static DSDPCMCTablesCache& instance() {
+		static DSDPCMCTablesCache cache;
+		return cache;
+	}
+	~DSDPCMCTablesCache() {
+		for (size_t i = 0; i < entries.size(); i++) {
+			delete entries[i].ctables;
+		}
+	}
+	DSDPCMCTables* acquire(const double* fir_coefs, int fir_length, double fir_gain, int radix, bool symmetric, bool fp32, size_t real_size, bool fixed, int planes) {
+		if (planes > 0) {
+			radix = 8;
+			symmetric = false;
+			fp32 = false;
+			real_size = sizeof(uint64_t);
+			fixed = false;
+		}
+		symmetric = symmetric && DSDPCMCTables::is_symmetric(fir_coefs, fir_length);
+		int entry_size = fixed ? sizeof(int32_t) : fp32 ? sizeof(float) : (int)real_size;
+		if (radix == 8 && !symmetric && !fixed && planes == 0) {
+			DSDPCMCTables* ctables = get_default(fir_coefs, fir_length, fir_gain, entry_size == sizeof(float));
+			if (ctables) {
+				return ctables;
+			}
+		}
+		Entry entry;
+		entry.fir_coefs.assign(fir_coefs, fir_coefs + fir_length);
+		entry.fir_gain = fir_gain;
+		entry.radix = radix;
+		entry.symmetric = symmetric;
+		entry.fixed = fixed;
+		entry.entry_size = entry_size;
+		entry.planes = planes;
+		entry.refs = 1;
+		entry.ctables = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(entries_lock);
+			DSDPCMCTables* ctables = add_ref(entry);
+			if (ctables) {
+				return ctables;
+			}
+		}
+		// tables are built unlocked, a concurrent build of the same entry loses
+		DSDPCMCTables* ctables = new DSDPCMCTables(fir_length, radix, symmetric, fp32, real_size, fixed, planes);
+		ctables->set_ctables(fir_coefs, fir_length, fir_gain);
+		std::lock_guard<std::mutex> lock(entries_lock);
+		DSDPCMCTables* cached = add_ref(entry);
+		if (cached) {
+			delete ctables;
+			return cached;
+		}
+		entry.ctables = ctables;
+		entries.push_back(entry);
+		return ctables;
+	}
+	void release(DSDPCMCTables* ctables) {
+		if (!ctables) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(entries_lock);
+		for (size_t i = 0; i < entries.size(); i++) {
+			if (entries[i].ctables == ctables) {
+				if (--entries[i].refs == 0) {
+					delete entries[i].ctables;
+					entries.erase(entries.begin() + i);
+				}
+				return;
+			}
+		}
+	}
+private:
+	DSDPCMCTables* add_ref(const Entry& key) {
+		for (size_t i = 0; i < entries.size(); i++) {
+			Entry& entry = entries[i];
+			if (entry.fir_gain == key.fir_gain && entry.radix == key.radix && entry.symmetric == key.symmetric && entry.fixed == key.fixed && entry.entry_size == key.entry_size && entry.planes == key.planes && entry.fir_coefs.size() == key.fir_coefs.size() && memcmp(entry.fir_coefs.data(), key.fir_coefs.data(), key.fir_coefs.size() * sizeof(double)) == 0) {
+				entry.refs++;
+				return entry.ctables;
+			}
+		}
+		return nullptr;
+	}
+	template<typename fir_t>
+	static bool is_default(const double* fir_coefs, int fir_length, double fir_gain) {
+		if (fir_length != fir_t::length || fir_gain != fir_t::gain()) {
+			return false;
+		}
+		for (int i = 0; i < fir_length; i++) {
+			if (fir_coefs[i] != fir_t::coef(i)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	template<typename fir_t>
+	static DSDPCMCTables* get_default(bool fp32) {
+		static DSDPCMCTables ctables_fp32(DSDPCMCTablesDefault<float, fir_t>::data, fir_t::length, true);
+		static DSDPCMCTables ctables_fp64(DSDPCMCTablesDefault<double, fir_t>::data, fir_t::length, false);
+		return fp32 ? &ctables_fp32 : &ctables_fp64;
+	}
+	static DSDPCMCTables* get_default(const double* fir_coefs, int fir_length, double fir_gain, bool fp32) {
+		if (is_default<DSDFIR1_8_DEFAULT>(fir_coefs, fir_length, fir_gain)) {
+			return get_default<DSDFIR1_8_DEFAULT>(fp32);
+		}
+		if (is_default<DSDFIR1_16_DEFAULT>(fir_coefs, fir_length, fir_gain)) {
+			return get_default<DSDFIR1_16_DEFAULT>(fp32);
+		}
+		if (is_default<DSDFIR1_64_DEFAULT>(fir_coefs, fir_length, fir_gain)) {
+			return get_default<DSDFIR1_64_DEFAULT>(fp32);
+		}
+		return nullptr;
+	}
+};
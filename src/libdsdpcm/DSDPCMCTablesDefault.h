@@ -0,0 +1,90 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <utility>
+
+#include "DSDPCMConstants.h"
+
+/*
+* Radix 8 lookup tables of the built-in DSD FIRs at 0 dB, evaluated by the
+* compiler. Entries are accumulated in the same order as
+* DSDPCMCTables::set_ctables, so they match the runtime-built tables.
+*/
+
+class DSDFIR1_8_DEFAULT {
+public:
+	static constexpr int length = DSDFIR1_8_LENGTH;
+	static constexpr double coef(int i) {
+		return DSDFIR1_8_COEFS[i];
+	}
+	static constexpr double gain() {
+		return 1.0 / (double)(1u << 28);
+	}
+};
+
+class DSDFIR1_16_DEFAULT {
+public:
+	static constexpr int length = DSDFIR1_16_LENGTH;
+	static constexpr double coef(int i) {
+		return DSDFIR1_16_COEFS[i];
+	}
+	static constexpr double gain() {
+		return 1.0 / (double)(1u << 28);
+	}
+};
+
+class DSDFIR1_64_DEFAULT {
+public:
+	static constexpr int length = DSDFIR1_64_LENGTH;
+	static constexpr double coef(int i) {
+		return DSDFIR1_64_COEFS[i];
+	}
+	static constexpr double gain() {
+		return 1.0 / (double)(1u << 31);
+	}
+};
+
+template<typename fir_t>
+class DSDPCMCTablesValue {
+	static constexpr int taps(int ct) {
+		return (fir_t::length - ct * 8 > 8) ? 8 : fir_t::length - ct * 8;
+	}
+	static constexpr double sum(int ct, int i, int j, int k, double cvalue) {
+		return (j < k) ? sum(ct, i, j + 1, k, cvalue + (((i >> (7 - j)) & 1) * 2 - 1) * fir_t::coef(fir_t::length - 1 - (ct * 8 + j))) : cvalue;
+	}
+public:
+	static constexpr double get(int n) {
+		return sum(n >> 8, n & 255, 0, taps(n >> 8), 0.0) * fir_t::gain();
+	}
+};
+
+template<typename table_t, typename fir_t, typename index_t = std::make_index_sequence<CTABLES(fir_t::length) * 256>>
+class DSDPCMCTablesDefault;
+
+template<typename table_t, typename fir_t, size_t... n>
+class DSDPCMCTablesDefault<table_t, fir_t, std::index_sequence<n...>> {
+public:
+	alignas(MEM_ALIGN) static constexpr table_t data[sizeof...(n)] = { (table_t)DSDPCMCTablesValue<fir_t>::get((int)n)... };
+};
+
+template<typename table_t, typename fir_t, size_t... n>
+constexpr table_t DSDPCMCTablesDefault<table_t, fir_t, std::index_sequence<n...>>::data[sizeof...(n)];
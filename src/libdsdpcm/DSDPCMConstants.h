@@ -32,9 +32,25 @@ static const int MEM_ALIGN = 64;
 #define DSDxFs256 (44100 * 256)
 #define DSDxFs512 (44100 * 512)
 
+#define PCMxFs48  48000
+#define PCMxFs48_INTERPOLATION 160
+#define PCMxFs48_DECIMATION    147
+#define PCMxFs48_TAPS          64
+
 #define DSD_SILENCE_BYTE 0x69
 
 #define CTABLES(fir_length) ((fir_length + 7) / 8)
+#define CTABLES_RADIX(fir_length, radix) ((fir_length + (radix) - 1) / (radix))
+#define CTABLES_PAD 4
+
+#define DSDPCM_RADIX_DEFAULT 8
+#define DSDPCM_RADIX_MAX     16
+
+#define DSDPCM_FUSED_SAMPLES 256
+
+#define DSDPCM_PLAN_RUNS 8
+
+#define DSDPCM_ARENA_REGION (2 << 20)
 
 #define DSDPCM_MAX_CHANNELS 6
 #define DSDPCM_MAX_FRAMELEN (DSDxFs128 / 75 / 8)
@@ -49,7 +65,7 @@ static const int MEM_ALIGN = 64;
 #define PCMFIR_OFFSET     0x7fffffff
 #define PCMFIR_SCALE      31
 
-const double DSDFIR1_8_COEFS[DSDFIR1_8_LENGTH] = {
+constexpr double DSDFIR1_8_COEFS[DSDFIR1_8_LENGTH] = {
 	-142,
 	-651,
 	-1997,
@@ -132,7 +148,7 @@ const double DSDFIR1_8_COEFS[DSDFIR1_8_LENGTH] = {
 	-142,
 };
 
-const double DSDFIR1_16_COEFS[DSDFIR1_16_LENGTH] = {
+constexpr double DSDFIR1_16_COEFS[DSDFIR1_16_LENGTH] = {
 	-42,
 	-102,
 	-220,
@@ -295,7 +311,7 @@ const double DSDFIR1_16_COEFS[DSDFIR1_16_LENGTH] = {
 	-42,
 };
 
-const double DSDFIR1_64_COEFS[DSDFIR1_64_LENGTH] = {
+constexpr double DSDFIR1_64_COEFS[DSDFIR1_64_LENGTH] = {
 	1652, 421, 509, 606, 714, 832,
 	960, 1098, 1245, 1402, 1567, 1739,
 	1917, 2101, 2287, 2475, 2663, 2848,
@@ -405,7 +421,7 @@ const double DSDFIR1_64_COEFS[DSDFIR1_64_LENGTH] = {
 	714, 606, 509, 421, 1652
 };
 
-const double PCMFIR2_2_COEFS[PCMFIR2_2_LENGTH] = {
+constexpr double PCMFIR2_2_COEFS[PCMFIR2_2_LENGTH] = {
 	349146,
 	0,
 	-2503287,
@@ -435,7 +451,7 @@ const double PCMFIR2_2_COEFS[PCMFIR2_2_LENGTH] = {
 	349146,
 };
 
-const double PCMFIR3_2_COEFS[PCMFIR3_2_LENGTH] = {
+constexpr double PCMFIR3_2_COEFS[PCMFIR3_2_LENGTH] = {
 	-5412,
 	0,
 	10344,
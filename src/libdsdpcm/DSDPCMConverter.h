@@ -33,7 +33,13 @@ enum conv_type_e {
 	DSDPCM_CONV_UNKNOWN    = -1,
 	DSDPCM_CONV_MULTISTAGE =  0,
 	DSDPCM_CONV_DIRECT     =  1,
-	DSDPCM_CONV_USER       =  2
+	DSDPCM_CONV_USER       =  2,
+	DSDPCM_CONV_LOWLATENCY =  3
+};
+
+enum conv_exec_e {
+	DSDPCM_EXEC_THREADS = 0,
+	DSDPCM_EXEC_LANES   = 1
 };
 
 enum declick_side_e {
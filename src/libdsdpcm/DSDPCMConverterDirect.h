@@ -20,11 +20,59 @@
 #pragma once
 
 #include "DSDPCMConverter.h"
+#include "DSDPCMFirFFT.h"
 
 template<typename real_t>
 class DSDPCMConverterDirect : public DSDPCMConverter<real_t> {
 };
 
+template<typename real_t>
+class DSDPCMConverterDirectFFT : public DSDPCMConverterDirect<real_t> {
+	DSDPCMFirFFT<real_t> dsd_fir1;
+	PCMPCMFir<real_t> pcm_fir[3];
+	int decimation;
+	int pcm_stages;
+public:
+	DSDPCMConverterDirectFFT(int decimation) {
+		this->decimation = decimation;
+		this->pcm_stages = 0;
+	}
+	static int get_fir1_decimation(int decimation) {
+		return (decimation >= 128) ? 64 : (decimation == 64) ? 32 : decimation;
+	}
+	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
+		int fir1_decimation = get_fir1_decimation(decimation);
+		this->alloc_pcm_temp1(dsd_samples * 8 / fir1_decimation);
+		this->alloc_pcm_temp2(dsd_samples * 8 / fir1_decimation / 2);
+		dsd_fir1.init(flt_setup.get_fir1_64_coefs(), flt_setup.get_fir1_64_length(), flt_setup.get_fir1_64_gain(), fir1_decimation);
+		this->delay = dsd_fir1.get_delay();
+		pcm_stages = 0;
+		for (int ratio = decimation / fir1_decimation; ratio > 1; ratio /= 2) {
+			if (ratio > 2) {
+				pcm_fir[pcm_stages].init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
+			}
+			else {
+				pcm_fir[pcm_stages].init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+			}
+			this->delay = this->delay / pcm_fir[pcm_stages].get_decimation() + pcm_fir[pcm_stages].get_delay();
+			pcm_stages++;
+		}
+	}
+	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		int pcm_samples;
+		if (pcm_stages == 0) {
+			return dsd_fir1.run(dsd_data, pcm_data, dsd_samples);
+		}
+		real_t* pcm_temp[2] = { this->pcm_temp1, this->pcm_temp2 };
+		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp[0], dsd_samples);
+		for (int stage = 0; stage < pcm_stages; stage++) {
+			real_t* pcm_out = (stage == pcm_stages - 1) ? pcm_data : pcm_temp[(stage + 1) & 1];
+			pcm_samples = pcm_fir[stage].run(pcm_temp[stage & 1], pcm_out, pcm_samples);
+		}
+		return pcm_samples;
+	}
+};
+
 template<typename real_t>
 class DSDPCMConverterDirect_x512 : public DSDPCMConverterDirect<real_t> {
 	DSDPCMFir<real_t> dsd_fir1;
@@ -33,20 +81,20 @@ class DSDPCMConverterDirect_x512 : public DSDPCMConverterDirect<real_t> {
 	PCMPCMFir<real_t> pcm_fir3;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples / 8);
-		alloc_pcm_temp2(dsd_samples / 16);
+		this->alloc_pcm_temp1(dsd_samples / 8);
+		this->alloc_pcm_temp2(dsd_samples / 16);
 		dsd_fir1.init(flt_setup.get_fir1_64_ctables(), flt_setup.get_fir1_64_length(), 64);
 		pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
 		pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-		delay = ((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+		this->delay = ((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 	}
 	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
-		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-		pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-		pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
-		pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
+		pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+		pcm_samples = pcm_fir2b.run(this->pcm_temp2, this->pcm_temp1, pcm_samples);
+		pcm_samples = pcm_fir3.run(this->pcm_temp1, pcm_data, pcm_samples);
 		return pcm_samples;
 	}
 };
@@ -58,18 +106,18 @@ class DSDPCMConverterDirect_x256 : public DSDPCMConverterDirect<real_t> {
 	PCMPCMFir<real_t> pcm_fir3;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples / 8);
-		alloc_pcm_temp2(dsd_samples / 16);
+		this->alloc_pcm_temp1(dsd_samples / 8);
+		this->alloc_pcm_temp2(dsd_samples / 16);
 		dsd_fir1.init(flt_setup.get_fir1_64_ctables(), flt_setup.get_fir1_64_length(), 64);
 		pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-		delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+		this->delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 	}
 	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
-		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-		pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-		pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
+		pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+		pcm_samples = pcm_fir3.run(this->pcm_temp2, pcm_data, pcm_samples);
 		return pcm_samples;
 	}
 };
@@ -80,15 +128,15 @@ class DSDPCMConverterDirect_x128 : public DSDPCMConverterDirect<real_t> {
 	PCMPCMFir<real_t> pcm_fir3;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples / 8);
+		this->alloc_pcm_temp1(dsd_samples / 8);
 		dsd_fir1.init(flt_setup.get_fir1_64_ctables(), flt_setup.get_fir1_64_length(), 64);
-		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-		delay = dsd_fir1.get_delay() / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+		this->delay = dsd_fir1.get_delay() / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 	}
 	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
-		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-		pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
+		pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = pcm_fir3.run(this->pcm_temp1, pcm_data, pcm_samples);
 		return pcm_samples;
 	}
 };
@@ -99,15 +147,15 @@ class DSDPCMConverterDirect_x64 : public DSDPCMConverterDirect<real_t> {
 	PCMPCMFir<real_t> pcm_fir3;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples / 4);
+		this->alloc_pcm_temp1(dsd_samples / 4);
 		dsd_fir1.init(flt_setup.get_fir1_64_ctables(), flt_setup.get_fir1_64_length(), 32);
-		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-		delay = dsd_fir1.get_delay() / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+		this->delay = dsd_fir1.get_delay() / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 	}
 	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
-		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-		pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
+		pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = pcm_fir3.run(this->pcm_temp1, pcm_data, pcm_samples);
 		return pcm_samples;
 	}
 };
@@ -117,9 +165,9 @@ class DSDPCMConverterDirect_x32: public DSDPCMConverterDirect<real_t> {
 	DSDPCMFir<real_t> dsd_fir1;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples / 4);
+		this->alloc_pcm_temp1(dsd_samples / 4);
 		dsd_fir1.init(flt_setup.get_fir1_64_ctables(), flt_setup.get_fir1_64_length(), 32);
-		delay = dsd_fir1.get_delay();
+		this->delay = dsd_fir1.get_delay();
 	}
 	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
@@ -133,9 +181,9 @@ class DSDPCMConverterDirect_x16 : public DSDPCMConverterDirect<real_t> {
 	DSDPCMFir<real_t> dsd_fir1;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples / 2);
+		this->alloc_pcm_temp1(dsd_samples / 2);
 		dsd_fir1.init(flt_setup.get_fir1_64_ctables(), flt_setup.get_fir1_64_length(), 16);
-		delay = dsd_fir1.get_delay();
+		this->delay = dsd_fir1.get_delay();
 	}
 	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
@@ -149,9 +197,9 @@ class DSDPCMConverterDirect_x8 : public DSDPCMConverterDirect<real_t> {
 	DSDPCMFir<real_t> dsd_fir1;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples);
+		this->alloc_pcm_temp1(dsd_samples);
 		dsd_fir1.init(flt_setup.get_fir1_64_ctables(), flt_setup.get_fir1_64_length(), 8);
-		delay = dsd_fir1.get_delay();
+		this->delay = dsd_fir1.get_delay();
 	}
 	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
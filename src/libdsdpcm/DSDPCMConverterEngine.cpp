@@ -19,6 +19,10 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
 #include "DSDPCMConverterEngine.h"
 
 #define LOG_ERROR   ("Error: ")
@@ -29,13 +33,99 @@
 extern void console_fprintf(FILE* file, const char* fmt, ...);
 extern void console_vfprintf(FILE* file, const char* fmt, va_list vl);
 
+static std::mutex               wisdom_lock;
+static std::vector<std::string> wisdom_unsaved; // plans the wisdom file did not take
+
+static FILE* open_wisdom(const std::string& wisdom_file, bool append) {
+#ifdef _WIN32
+	int wide_length = MultiByteToWideChar(CP_UTF8, 0, wisdom_file.c_str(), -1, nullptr, 0);
+	if (wide_length <= 0) {
+		return nullptr;
+	}
+	std::vector<wchar_t> wide_file(wide_length);
+	MultiByteToWideChar(CP_UTF8, 0, wisdom_file.c_str(), -1, wide_file.data(), wide_length);
+	return _wfopen(wide_file.data(), append ? L"a" : L"r");
+#else
+	return fopen(wisdom_file.c_str(), append ? "a" : "r");
+#endif
+}
+
+/*
+* Once silence_settle bytes of idle pattern have passed, every FIR history of
+* the cascade holds its steady state and each output sample is the same. An
+* idle frame then just repeats that level: skipping it leaves the histories
+* as they are, so the output is bit-identical to converting it.
+*/
+template<typename real_t>
+static int ConverterRun(DSDPCMConverterSlot<real_t>* slot) {
+	bool silent = slot->silence_settle > 0 && DSDPCMUtil::is_silence(slot->dsd_data, slot->dsd_samples);
+	if (silent && slot->silence_bytes >= slot->silence_settle && slot->dsd_samples == slot->silence_dsd_samples) {
+		for (int sample = 0; sample < slot->silence_pcm_samples; sample++) {
+			slot->pcm_data[sample] = slot->silence_level;
+		}
+		return slot->silence_pcm_samples;
+	}
+	int pcm_samples = slot->converter->convert(slot->dsd_data, slot->pcm_data, slot->dsd_samples);
+	if (!silent) {
+		slot->silence_bytes = 0;
+		return pcm_samples;
+	}
+	if (slot->silence_bytes < slot->silence_settle) {
+		slot->silence_bytes += slot->dsd_samples;
+	}
+	if (slot->silence_bytes >= slot->silence_settle && pcm_samples > 0) {
+		slot->silence_dsd_samples = slot->dsd_samples;
+		slot->silence_pcm_samples = pcm_samples;
+		slot->silence_level = slot->pcm_data[pcm_samples - 1];
+	}
+	return pcm_samples;
+}
+
+template<typename real_t>
+static int ConverterBatch(DSDPCMConverterSlot<real_t>* slot) {
+	int pcm_samples = 0;
+	int channel = slot->channel;
+	int channels = slot->channels;
+	for (int frame = 0; frame < slot->batch_frames; frame++) {
+		uint8_t* dsd_data = slot->batch_dsd_data + frame * slot->dsd_samples * channels;
+		for (int sample = 0; sample < slot->dsd_samples; sample++) {
+			slot->dsd_data[sample] = dsd_data[sample * channels + channel];
+		}
+		int frame_samples = ConverterRun<real_t>(slot);
+		if (frame < slot->batch_skip) {
+			continue;
+		}
+		float* pcm_data = slot->batch_pcm_data + pcm_samples * channels;
+		for (int sample = 0; sample < frame_samples; sample++) {
+			pcm_data[sample * channels + channel] = (float)(slot->pcm_data[sample] * slot->batch_gain);
+		}
+		pcm_samples += frame_samples;
+	}
+	return pcm_samples;
+}
+
+template<typename real_t>
+static DSDPCMConverter<real_t>* new_converter_fft(int decimation) {
+	return new DSDPCMConverterDirectFFT<real_t>(decimation);
+}
+
+template<>
+DSDPCMConverter<int32_t>* new_converter_fft<int32_t>(int) {
+	return nullptr; // fixed point always runs on lookup tables
+}
+
 template<typename real_t>
 static DWORD WINAPI ConverterThread(LPVOID threadarg) {
 	DSDPCMConverterSlot<real_t>* slot = reinterpret_cast<DSDPCMConverterSlot<real_t>*>(threadarg);
 	while (slot->run_slot) {
 		WaitForSingleObject(slot->hEventPut, INFINITE);
 		if (slot->run_slot) {
-			slot->pcm_samples = slot->converter->convert(slot->dsd_data, slot->pcm_data, slot->dsd_samples);
+			if (slot->batch_frames > 0) {
+				slot->pcm_samples = ConverterBatch<real_t>(slot);
+			}
+			else {
+				slot->pcm_samples = ConverterRun<real_t>(slot);
+			}
 		}
 		else {
 			slot->pcm_samples = 0;
@@ -51,17 +141,44 @@ DSDPCMConverterEngine::DSDPCMConverterEngine() {
 	dsd_samplerate = 0;
 	pcm_samplerate = 0;
 	dB_gain = 0.0f;
+	conv_gain = 1.0;
+	ctables_radix = DSDPCM_RADIX_DEFAULT;
+	ctables_fp32 = false;
+	ctables_symmetric = false;
+	ctables_planes = 0;
 	conv_delay = 0.0f;
 	conv_type = DSDPCM_CONV_UNKNOWN;
+	conv_exec = DSDPCM_EXEC_THREADS;
+	init_exec = DSDPCM_EXEC_THREADS;
+	init_downmix = false;
+	conv_fixed = false;
+	conv_mixed = false;
+	conv_fft = false;
 	convSlots_fp32 = nullptr;
 	convSlots_fp64 = nullptr;
-	conv_called = false;
-	for (int i = 0; i < 256; i++) {
-		swap_bits[i] = 0;
-		for (int j = 0; j < 8; j++) {
-			swap_bits[i] |= ((i >> j) & 1) << (7 - j);
-		}
-	}
+	convSlots_int32 = nullptr;
+	convLanes_fp32 = nullptr;
+	convLanes_fp64 = nullptr;
+	convLanes_int32 = nullptr;
+	stream_data = nullptr;
+	stream_size = 0;
+	stream_in = 0;
+	stream_out = 0;
+	stream_pcm = nullptr;
+	delay_trim = false;
+	trim_delay = 0;
+	trim_pending = 0;
+	multirate_outputs = 0;
+	downmix_channels = 0;
+	downmix_pcm_channels = 0;
+	pcm_channels = 0;
+	pcm_format = DSDPCM_PCM_FLOAT32;
+	pcm_dither = true;
+	pcm_noise_shaping = false;
+	time_split = 1;
+	wisdom_plan = true;
+	split_segments = 1;
+	split_prime = 0;
 }
 
 DSDPCMConverterEngine::~DSDPCMConverterEngine() {
@@ -73,17 +190,168 @@ float DSDPCMConverterEngine::get_delay() {
 	return conv_delay;
 }
 
+float DSDPCMConverterEngine::get_stream_delay() {
+	return delay_trim ? conv_delay - (float)trim_delay : conv_delay;
+}
+
+float DSDPCMConverterEngine::get_multirate_delay(int output) {
+	return (output > 0 && output < multirate_outputs) ? multirate_delay[output] : conv_delay;
+}
+
+int DSDPCMConverterEngine::get_pcm_channels() {
+	return pcm_channels;
+}
+
 void DSDPCMConverterEngine::set_gain(float dB_gain) {
 	this->dB_gain = dB_gain;
+	this->conv_gain = pow(10.0, dB_gain / 20.0);
+}
+
+void DSDPCMConverterEngine::set_exec_mode(conv_exec_e conv_exec) {
+	this->conv_exec = conv_exec;
+}
+
+void DSDPCMConverterEngine::set_fixed_point(bool conv_fixed) {
+	this->conv_fixed = conv_fixed;
+}
+
+/*
+* Single precision inits keep fp32 tables, samples and first-stage sums, and
+* sum only the last PCM stage (PCMFIR3_2 or the polyphase resampler) in
+* double. Double precision and fixed point inits are not affected.
+*/
+void DSDPCMConverterEngine::set_mixed_precision(bool conv_mixed) {
+	this->conv_mixed = conv_mixed;
+}
+
+/*
+* Table radix, fp32 entries in double precision cascades and symmetric
+* (mirrored) tables. SNR against the fp64 cascade with fp64 tables, DSD64
+* and DSD256 to 48-352.8 kHz, Multistage and Low latency:
+*   fp32                      135-146 dB
+*   fp32, mixed precision     142-146 dB, same speed as fp32
+*   fp64 with fp32 tables     148-155 dB
+* Direct has no PCMFIR3_2, mixed precision only lifts its 48 kHz family
+* resampler from 134 to 137 dB.
+*/
+void DSDPCMConverterEngine::set_ctables_layout(int radix, bool fp32, bool symmetric) {
+	this->ctables_radix = radix;
+	this->ctables_fp32 = fp32;
+	this->ctables_symmetric = symmetric;
+}
+
+/*
+* Coefficient bits of the bit-plane (popcount) first stage, 0 for lookup
+* tables. 24 bits are on par with fp32 tables, 32 bits well above fp64 ones
+* (dsdpcm_verify). In fixed point 32 bits give the table output bit for bit
+* with the built-in Multistage filters only. Direct comes out at 164-168 dB
+* against 148-151 dB for the tables, which round every table entry to Q28.
+* Only pays off where popcount vectorizes (AVX-512 VPOPCNTDQ), elsewhere the
+* lookup tables are faster. The IPP build ignores it for floating point.
+*/
+void DSDPCMConverterEngine::set_ctables_planes(int planes) {
+	this->ctables_planes = planes;
+}
+
+/*
+* With trimming on, convert_stream drops the first round(delay) samples and
+* the nullptr flush emits the ring-out, so a decoded track keeps its exact
+* length. Playback leaves it off and never flushes: the remainder and the
+* filter state carry over to the next track of a skipped init.
+*/
+void DSDPCMConverterEngine::set_delay_trim(bool delay_trim) {
+	this->delay_trim = delay_trim;
+}
+
+/*
+* Extra PCM rates for convert_multirate, output 0 being the init samplerate.
+* Takes effect on the next init; outputs = 0 turns multirate mode off.
+*/
+void DSDPCMConverterEngine::set_multirate(int* pcm_samplerates, int outputs) {
+	if (outputs > DSDPCM_MAX_OUTPUTS - 1) {
+		outputs = DSDPCM_MAX_OUTPUTS - 1;
+	}
+	for (int i = 0; i < outputs; i++) {
+		multirate_samplerates[i + 1] = pcm_samplerates[i];
+	}
+	multirate_outputs = (outputs > 0) ? outputs + 1 : 0;
 }
 
+/*
+* Row-major pcm_channels x channels matrix mixing the DSD channels into the
+* PCM ones, entries below DSDPCM_MAX_GAIN in magnitude (a matrix with larger
+* ones turns the downmix off). It is applied right after the first FIR
+* stage, the rest of the cascade runs for the PCM channels only; the
+* conversion then always runs on the lanes executor. Takes effect on the next init with that many channels,
+* inits with another channel count convert without it. Multirate outputs
+* cannot be mixed, init fails with the two combined; nullptr turns the
+* downmix off.
+*/
+void DSDPCMConverterEngine::set_downmix(const double* matrix, int channels, int pcm_channels) {
+	if (!matrix || channels < 1 || channels > DSDPCM_MAX_CHANNELS || pcm_channels < 1 || pcm_channels > DSDPCM_MAX_CHANNELS) {
+		downmix_channels = 0;
+		downmix_pcm_channels = 0;
+		return;
+	}
+	for (int i = 0; i < pcm_channels * channels; i++) {
+		if (!(fabs(matrix[i]) < DSDPCM_MAX_GAIN)) {
+			downmix_channels = 0;
+			downmix_pcm_channels = 0;
+			return;
+		}
+		downmix_matrix[i] = matrix[i];
+	}
+	downmix_channels = channels;
+	downmix_pcm_channels = pcm_channels;
+}
 
-bool DSDPCMConverterEngine::is_convert_called() {
-	return conv_called;
+/*
+* Sample format written by convert_pcm. The integer formats get TPDF dither
+* of +-1 LSB unless dither is off, noise shaping moves the quantization noise
+* up to the top of the band. Takes effect on the next convert_pcm call, the
+* dither sequence and the noise shaper state start over.
+*/
+void DSDPCMConverterEngine::set_output_format(pcm_format_e pcm_format, bool dither, bool noise_shaping) {
+	this->pcm_format = pcm_format;
+	this->pcm_dither = dither;
+	this->pcm_noise_shaping = noise_shaping;
+	quantizer.init(pcm_channels, pcm_dither, pcm_noise_shaping);
+}
+
+/*
+* File the planner keeps its choices in, a UTF-8 path. Takes effect on the
+* next init; nullptr turns the planner off. Timing the candidates takes up to
+* a couple of seconds, so with wisdom_plan off an init only applies a plan the
+* file already has and converts as requested otherwise, leaving the timing to
+* a later init that may plan.
+*/
+void DSDPCMConverterEngine::set_wisdom(const char* wisdom_file, bool wisdom_plan) {
+	this->wisdom_file = wisdom_file ? wisdom_file : "";
+	this->wisdom_plan = wisdom_plan;
+}
+
+/*
+* Page backing of the engine arena and of lookup tables made for it. Takes
+* effect on the next init.
+*/
+void DSDPCMConverterEngine::set_huge_pages(arena_pages_e pages) {
+	arena.set_pages(pages);
+}
+
+/*
+* Number of time segments convert_batch splits every channel into, each on
+* its own converter thread. Takes effect on the next init, only in the
+* threads mode and for cascades without FFT, polyphase or multirate stages.
+*/
+void DSDPCMConverterEngine::set_time_split(int segments) {
+	this->time_split = (segments > 1) ? segments : 1;
 }
 
 int DSDPCMConverterEngine::init(int channels, int framerate, int dsd_samplerate, int pcm_samplerate, conv_type_e conv_type, bool conv_fp64, double* fir_coefs, int fir_length, bool skip_init) {
-	if (skip_init && this->channels == channels && this->framerate == framerate && this->dsd_samplerate == dsd_samplerate && this->pcm_samplerate == pcm_samplerate) {
+	bool downmix = downmix_pcm_channels > 0 && channels == downmix_channels;
+	int pcm_channels = downmix ? downmix_pcm_channels : channels;
+	bool same_downmix = init_downmix == downmix && (!downmix || memcmp(init_downmix_matrix, downmix_matrix, pcm_channels * channels * sizeof(double)) == 0);
+	if (skip_init && this->channels == channels && this->pcm_channels == pcm_channels && init_exec == conv_exec && same_downmix && this->framerate == framerate && this->dsd_samplerate == dsd_samplerate && this->pcm_samplerate == pcm_samplerate) {
 		return 1;
 	}
 	if (conv_type == DSDPCM_CONV_USER) {
@@ -91,26 +359,131 @@ int DSDPCMConverterEngine::init(int channels, int framerate, int dsd_samplerate,
 			return -2;
 		}
 	}
+	if (multirate_outputs > 0) {
+		if (!(conv_type == DSDPCM_CONV_MULTISTAGE || conv_type == DSDPCM_CONV_LOWLATENCY)) {
+			return -2;
+		}
+#ifdef _USE_IPP
+		if (conv_fixed) {
+			return -2;
+		}
+#endif
+		multirate_samplerates[0] = pcm_samplerate;
+		for (int i = 0; i < multirate_outputs; i++) {
+			int samplerate = multirate_samplerates[i];
+			int decimation = (samplerate > 0 && dsd_samplerate % samplerate == 0) ? dsd_samplerate / samplerate : 0;
+			if (decimation < 8 || decimation > 512 || (decimation & (decimation - 1)) != 0) {
+				return -2;
+			}
+			multirate_decimation[i] = decimation;
+		}
+	}
+	if (downmix && multirate_outputs > 0) {
+		return -2;
+	}
 	free();
 	this->channels = channels;
+	this->pcm_channels = pcm_channels;
+	init_exec = conv_exec;
+	init_downmix = downmix;
+	if (downmix) {
+		memcpy(init_downmix_matrix, downmix_matrix, pcm_channels * channels * sizeof(double));
+	}
+	quantizer.init(pcm_channels, pcm_dither, pcm_noise_shaping);
 	this->framerate = framerate;
 	this->dsd_samplerate = dsd_samplerate;
 	this->pcm_samplerate = pcm_samplerate;
 	this->conv_type = conv_type;
 	this->conv_fp64 = conv_fp64;
-	if (conv_fp64) {
-		fltSetup_fp64.set_gain(dB_gain);
+	if (!wisdom_file.empty() && multirate_outputs == 0) {
+		conv_exec_e exec = conv_exec;
+		int radix = ctables_radix;
+		bool symmetric = ctables_symmetric;
+		plan(fir_coefs, fir_length);
+		int rv = init_converter(fir_coefs, fir_length);
+		conv_exec = exec;
+		ctables_radix = radix;
+		ctables_symmetric = symmetric;
+		return rv;
+	}
+	return init_converter(fir_coefs, fir_length);
+}
+
+int DSDPCMConverterEngine::init_converter(double* fir_coefs, int fir_length) {
+	free();
+	DSDPCMArenaScope arena_scope(&arena);
+	this->conv_fft = false;
+	bool downmix = init_downmix;
+	if (conv_type == DSDPCM_CONV_USER && !conv_fixed && !downmix) {
+		int interpolation, resampler_decimation;
+		int decimation = get_decimation(interpolation, resampler_decimation);
+		this->conv_fft = DSDPCMFirFFT<double>::is_cheaper(fir_length, DSDPCMConverterDirectFFT<double>::get_fir1_decimation(decimation));
+	}
+	if (conv_fixed) {
+		fltSetup_int32.set_ctables_layout(ctables_radix, false, ctables_symmetric);
+		fltSetup_int32.set_ctables_planes(ctables_planes);
+		fltSetup_int32.set_min_phase(conv_type == DSDPCM_CONV_LOWLATENCY);
+		fltSetup_int32.set_fir1_64_coefs(fir_coefs, fir_length);
+		bool fixed_lanes = (conv_exec == DSDPCM_EXEC_LANES || downmix) && !multirate_outputs;
+#ifdef _USE_IPP
+		fixed_lanes = true; // IPP kernels are floating point only
+#endif
+		if (fixed_lanes) {
+			convLanes_int32 = init_lanes<int32_t>(fltSetup_int32);
+			if (!convLanes_int32) {
+				return -1;
+			}
+			conv_delay = convLanes_int32->get_delay();
+		}
+#ifndef _USE_IPP
+		else {
+			convSlots_int32 = init_slots<int32_t>(fltSetup_int32);
+			conv_delay = convSlots_int32[0].converter->get_delay();
+		}
+#endif
+	}
+	else if (conv_fp64) {
+		fltSetup_fp64.set_ctables_layout(ctables_radix, ctables_fp32, ctables_symmetric);
+		fltSetup_fp64.set_ctables_planes(ctables_planes);
+		fltSetup_fp64.set_min_phase(conv_type == DSDPCM_CONV_LOWLATENCY);
 		fltSetup_fp64.set_fir1_64_coefs(fir_coefs, fir_length);
-		convSlots_fp64 = init_slots<double>(fltSetup_fp64);
-		conv_delay = convSlots_fp64[0].converter->get_delay();
+		if ((conv_exec == DSDPCM_EXEC_LANES || downmix) && !conv_fft && !multirate_outputs) {
+			convLanes_fp64 = init_lanes<double>(fltSetup_fp64);
+			if (!convLanes_fp64) {
+				return -1;
+			}
+			conv_delay = convLanes_fp64->get_delay();
+		}
+		else {
+			convSlots_fp64 = init_slots<double>(fltSetup_fp64);
+			conv_delay = convSlots_fp64[0].converter->get_delay();
+		}
 	}
 	else {
-		fltSetup_fp32.set_gain(dB_gain);
+		fltSetup_fp32.set_ctables_layout(ctables_radix, ctables_fp32, ctables_symmetric);
+		fltSetup_fp32.set_ctables_planes(ctables_planes);
+		fltSetup_fp32.set_pcm_sum_fp64(conv_mixed);
+		fltSetup_fp32.set_min_phase(conv_type == DSDPCM_CONV_LOWLATENCY);
 		fltSetup_fp32.set_fir1_64_coefs(fir_coefs, fir_length);
-		convSlots_fp32 = init_slots<float>(fltSetup_fp32);
-		conv_delay = convSlots_fp32[0].converter->get_delay();
+		if ((conv_exec == DSDPCM_EXEC_LANES || downmix) && !conv_fft && !multirate_outputs) {
+			convLanes_fp32 = init_lanes<float>(fltSetup_fp32);
+			if (!convLanes_fp32) {
+				return -1;
+			}
+			conv_delay = convLanes_fp32->get_delay();
+		}
+		else {
+			convSlots_fp32 = init_slots<float>(fltSetup_fp32);
+			conv_delay = convSlots_fp32[0].converter->get_delay();
+		}
 	}
-	conv_called = false;
+	stream_data = (uint8_t*)DSDPCMUtil::mem_alloc(dsd_samplerate / 8 / framerate * channels);
+	stream_size = 0;
+	stream_in = 0;
+	stream_out = 0;
+	stream_pcm = (float*)DSDPCMUtil::mem_alloc(pcm_samplerate / framerate * pcm_channels * sizeof(float));
+	trim_delay = (int)(conv_delay + 0.5f);
+	trim_pending = delay_trim ? trim_delay : 0;
 	return 0;
 }
 
@@ -123,54 +496,422 @@ int DSDPCMConverterEngine::free() {
 		free_slots<float>(convSlots_fp32);
 		convSlots_fp32 = nullptr;
 	}
+	if (convLanes_fp64) {
+		delete convLanes_fp64;
+		convLanes_fp64 = nullptr;
+	}
+	if (convSlots_int32) {
+		free_slots<int32_t>(convSlots_int32);
+		convSlots_int32 = nullptr;
+	}
+	if (convLanes_fp32) {
+		delete convLanes_fp32;
+		convLanes_fp32 = nullptr;
+	}
+	if (convLanes_int32) {
+		delete convLanes_int32;
+		convLanes_int32 = nullptr;
+	}
+	DSDPCMUtil::mem_free(stream_data);
+	stream_data = nullptr;
+	stream_size = 0;
+	DSDPCMUtil::mem_free(stream_pcm);
+	stream_pcm = nullptr;
+	fltSetup_fp32.flush();
+	fltSetup_fp64.flush();
+	fltSetup_int32.flush();
+	arena.release();
 	return 0;
 }
 
 int DSDPCMConverterEngine::convert(uint8_t* dsd_data, int dsd_samples, float* pcm_data) {
+	return convert_format(dsd_data, dsd_samples, pcm_data, DSDPCM_PCM_FLOAT32);
+}
+
+/*
+* Converts like convert() and writes the samples in the output format, the
+* integer formats quantized with dither and noise shaping as set. Returns the
+* number of samples, the payload is that times the sample bytes.
+*/
+int DSDPCMConverterEngine::convert_pcm(uint8_t* dsd_data, int dsd_samples, uint8_t* pcm_data) {
+	return convert_format(dsd_data, dsd_samples, pcm_data, pcm_format);
+}
+
+int DSDPCMConverterEngine::convert_format(uint8_t* dsd_data, int dsd_samples, void* pcm_data, pcm_format_e pcm_format) {
 	int pcm_samples = 0;
-	if (!dsd_data) {
+	if (multirate_outputs > 0) {
+		return 0;
+	}
+	if (convSlots_fp64) {
+		pcm_samples = convert<double>(convSlots_fp64, dsd_data, dsd_samples, pcm_data, pcm_format);
+	}
+	if (convSlots_fp32) {
+		pcm_samples = convert<float>(convSlots_fp32, dsd_data, dsd_samples, pcm_data, pcm_format);
+	}
+	if (convLanes_fp64) {
+		pcm_samples = convert<double>(convLanes_fp64, dsd_data, dsd_samples, pcm_data, pcm_format);
+	}
+	if (convLanes_fp32) {
+		pcm_samples = convert<float>(convLanes_fp32, dsd_data, dsd_samples, pcm_data, pcm_format);
+	}
+	if (convSlots_int32) {
+		pcm_samples = convert<int32_t>(convSlots_int32, dsd_data, dsd_samples, pcm_data, pcm_format);
+	}
+	if (convLanes_int32) {
+		pcm_samples = convert<int32_t>(convLanes_int32, dsd_data, dsd_samples, pcm_data, pcm_format);
+	}
+	return pcm_samples;
+}
+
+int DSDPCMConverterEngine::convert_batch(uint8_t* dsd_data, int dsd_samples, float* pcm_data) {
+	int frame_size = dsd_samplerate / 8 / framerate * channels;
+	int dsd_frames = dsd_samples / frame_size;
+	int pcm_samples = 0;
+	if (multirate_outputs > 0) {
+		return 0;
+	}
+	if (dsd_frames > 0) {
 		if (convSlots_fp64) {
-			pcm_samples = convertR<double>(convSlots_fp64, pcm_data);
+			pcm_samples = convert_batch<double>(convSlots_fp64, dsd_data, dsd_frames, pcm_data);
 		}
 		if (convSlots_fp32) {
-			pcm_samples = convertR<float>(convSlots_fp32, pcm_data);
+			pcm_samples = convert_batch<float>(convSlots_fp32, dsd_data, dsd_frames, pcm_data);
+		}
+		if (convSlots_int32) {
+			pcm_samples = convert_batch<int32_t>(convSlots_int32, dsd_data, dsd_frames, pcm_data);
+		}
+		if (convLanes_fp64 || convLanes_fp32 || convLanes_int32) {
+			for (int frame = 0; frame < dsd_frames; frame++) {
+				if (convLanes_fp64) {
+					pcm_samples += convert<double>(convLanes_fp64, dsd_data + frame * frame_size, frame_size, pcm_data + pcm_samples);
+				}
+				if (convLanes_fp32) {
+					pcm_samples += convert<float>(convLanes_fp32, dsd_data + frame * frame_size, frame_size, pcm_data + pcm_samples);
+				}
+				if (convLanes_int32) {
+					pcm_samples += convert<int32_t>(convLanes_int32, dsd_data + frame * frame_size, frame_size, pcm_data + pcm_samples);
+				}
+			}
 		}
-		return pcm_samples;
 	}
-	if (!conv_called) {
-		if (convSlots_fp64) {
-			convertL<double>(convSlots_fp64, dsd_data, dsd_samples);
+	int dsd_remain = dsd_samples - dsd_frames * frame_size;
+	if (dsd_remain > 0) {
+		pcm_samples += convert(dsd_data + dsd_frames * frame_size, dsd_remain, pcm_data + pcm_samples);
+	}
+	return pcm_samples;
+}
+
+/*
+* Accepts interleaved DSD of any length. Whole frames are converted, the
+* remainder is kept until the next call. Called with nullptr, the remainder is
+* padded with DSD silence and converted together with the filter ring-out; the
+* flush returns at most one frame per call and 0 once the stream is complete.
+* With delay trimming on, the first round(delay) output samples are dropped,
+* so the stream returns exactly as many samples as the input covers and
+* get_stream_delay() is the remaining sub-sample offset.
+*/
+int DSDPCMConverterEngine::convert_stream(uint8_t* dsd_data, int dsd_samples, float* pcm_data) {
+	return convert_stream(dsd_data, dsd_samples, pcm_data, DSDPCM_PCM_FLOAT32);
+}
+
+/*
+* Streams like convert_stream() and writes the samples in the output format
+* of convert_pcm(), with the same remainder handling and delay trim. Whole
+* frames are converted one by one rather than as a batch.
+*/
+int DSDPCMConverterEngine::convert_stream_pcm(uint8_t* dsd_data, int dsd_samples, uint8_t* pcm_data) {
+	return convert_stream(dsd_data, dsd_samples, pcm_data, pcm_format);
+}
+
+int DSDPCMConverterEngine::convert_stream(uint8_t* dsd_data, int dsd_samples, void* pcm_data, pcm_format_e pcm_format) {
+	int frame_size = dsd_samplerate / 8 / framerate * channels;
+	int sample_bytes = (pcm_format == DSDPCM_PCM_FLOAT32) ? (int)sizeof(float) : DSDPCMQuantizer::get_sample_bytes(pcm_format);
+	uint8_t* pcm_bytes = (uint8_t*)pcm_data;
+	int pcm_samples = 0;
+	if (multirate_outputs > 0) {
+		return 0;
+	}
+	if (!dsd_data) {
+		int64_t pcm_frame = pcm_samplerate / framerate;
+		int64_t stream_end = (stream_in * pcm_frame + frame_size / 2) / frame_size + trim_delay;
+		while (stream_in > 0 && stream_out < stream_end) {
+			memset(stream_data + stream_size, DSD_SILENCE_BYTE, frame_size - stream_size);
+			stream_size = 0;
+			pcm_samples = convert_format(stream_data, frame_size, pcm_data, pcm_format) / pcm_channels;
+			if (stream_out + pcm_samples > stream_end) {
+				pcm_samples = (int)(stream_end - stream_out);
+			}
+			stream_out += pcm_samples;
+			pcm_samples = trim_stream(pcm_data, pcm_samples * pcm_channels, sample_bytes);
+			if (pcm_samples > 0) {
+				return pcm_samples;
+			}
 		}
-		if (convSlots_fp32) {
-			convertL<float>(convSlots_fp32, dsd_data, dsd_samples);
+		return 0;
+	}
+	stream_in += dsd_samples;
+	if (stream_size > 0) {
+		int stream_fill = (frame_size - stream_size < dsd_samples) ? frame_size - stream_size : dsd_samples;
+		memcpy(stream_data + stream_size, dsd_data, stream_fill);
+		stream_size += stream_fill;
+		dsd_data += stream_fill;
+		dsd_samples -= stream_fill;
+		if (stream_size < frame_size) {
+			return 0;
+		}
+		stream_size = 0;
+		pcm_samples += convert_format(stream_data, frame_size, pcm_data, pcm_format);
+	}
+	int dsd_frames = dsd_samples / frame_size;
+	if (dsd_frames > 0) {
+		if (pcm_format == DSDPCM_PCM_FLOAT32) {
+			pcm_samples += convert_batch(dsd_data, dsd_frames * frame_size, (float*)pcm_data + pcm_samples);
+		}
+		else {
+			for (int frame = 0; frame < dsd_frames; frame++) {
+				pcm_samples += convert_format(dsd_data + frame * frame_size, frame_size, pcm_bytes + pcm_samples * sample_bytes, pcm_format);
+			}
 		}
-		conv_called = true;
 	}
+	stream_size = dsd_samples - dsd_frames * frame_size;
+	memcpy(stream_data, dsd_data + dsd_frames * frame_size, stream_size);
+	stream_out += pcm_samples / pcm_channels;
+	return trim_stream(pcm_data, pcm_samples, sample_bytes);
+}
+
+/*
+* Starts convert_stream over, as after a seek: the kept remainder is dropped,
+* the sample counts restart and the delay is trimmed again if trimming is on.
+* The filter history is left as it is.
+*/
+void DSDPCMConverterEngine::reset_stream() {
+	stream_size = 0;
+	stream_in = 0;
+	stream_out = 0;
+	trim_pending = delay_trim ? trim_delay : 0;
+}
+
+/*
+* Multirate mode: converts interleaved DSD like convert() and writes output i,
+* interleaved, to pcm_data[i] and its sample count to pcm_samples[i]. The
+* cascades run on the converter slots only; convert, convert_batch and
+* convert_stream return nothing in this mode.
+*/
+int DSDPCMConverterEngine::convert_multirate(uint8_t* dsd_data, int dsd_samples, float** pcm_data, int* pcm_samples) {
+	int out_samples = 0;
 	if (convSlots_fp64) {
-		pcm_samples = convert<double>(convSlots_fp64, dsd_data, dsd_samples, pcm_data);
+		out_samples = convert_multirate<double>(convSlots_fp64, dsd_data, dsd_samples, pcm_data, pcm_samples);
 	}
 	if (convSlots_fp32) {
-		pcm_samples = convert<float>(convSlots_fp32, dsd_data, dsd_samples, pcm_data);
+		out_samples = convert_multirate<float>(convSlots_fp32, dsd_data, dsd_samples, pcm_data, pcm_samples);
 	}
-	return pcm_samples;
+	if (convSlots_int32) {
+		out_samples = convert_multirate<int32_t>(convSlots_int32, dsd_data, dsd_samples, pcm_data, pcm_samples);
+	}
+	return out_samples;
 }
 
+/*
+* Picks the fastest implementation whose output is the same or better than
+* the requested one: slots or lanes, larger table radix, symmetric tables,
+* double in place of single precision. Candidates are timed on the first init
+* of a configuration that may plan, the winner is appended to the wisdom file
+* and reused by later inits.
+*/
+void DSDPCMConverterEngine::plan(double* fir_coefs, int fir_length) {
+	char plan_key[128];
+	snprintf(plan_key, sizeof(plan_key), "%d %d %d %d %d %d %d %d %d %d %d %d", channels, pcm_channels, framerate, dsd_samplerate, pcm_samplerate, (int)conv_type, conv_fp64, conv_fixed, conv_mixed, ctables_fp32, ctables_planes, fir_length);
+	if (load_wisdom(plan_key) || !wisdom_plan) {
+		return;
+	}
+	int radix = ctables_radix;
+	int radix_list[3] = { radix, DSDPCM_RADIX_DEFAULT, DSDPCM_RADIX_MAX };
+	bool fp64 = conv_fp64;
+	conv_exec_e best_exec = conv_exec;
+	int best_radix = radix;
+	bool best_symmetric = ctables_symmetric;
+	bool best_fp64 = fp64;
+	double best_time = 0.0;
+	for (int p = (fp64 || conv_fixed) ? 1 : 0; p < 2; p++) {
+		for (int r = 0; r < 3; r++) {
+			if (r > 0 && radix_list[r] <= radix) {
+				continue;
+			}
+			for (int s = 0; s < 2; s++) {
+				for (int e = 0; e < 2; e++) {
+					conv_fp64 = conv_fixed ? fp64 : p == 1;
+					ctables_radix = radix_list[r];
+					ctables_symmetric = s == 1;
+					conv_exec = (e == 1) ? DSDPCM_EXEC_LANES : DSDPCM_EXEC_THREADS;
+					if (init_converter(fir_coefs, fir_length) < 0) {
+						continue;
+					}
+					double time = time_converter();
+					if (best_time == 0.0 || time < best_time) {
+						best_time = time;
+						best_exec = conv_exec;
+						best_radix = ctables_radix;
+						best_symmetric = ctables_symmetric;
+						best_fp64 = conv_fp64;
+					}
+				}
+			}
+		}
+	}
+	free();
+	conv_exec = best_exec;
+	ctables_radix = best_radix;
+	ctables_symmetric = best_symmetric;
+	conv_fp64 = best_fp64;
+	save_wisdom(plan_key);
+}
+
+double DSDPCMConverterEngine::time_converter() {
+	int frame_size = dsd_samplerate / 8 / framerate * channels;
+	uint32_t bits = 1;
+	for (int i = 0; i < frame_size; i++) {
+		bits = bits * 1664525 + 1013904223;
+		stream_data[i] = (uint8_t)(bits >> 24);
+	}
+	convert(stream_data, frame_size, stream_pcm);
+	double best_time = 0.0;
+	for (int run = 0; run < DSDPCM_PLAN_RUNS; run++) {
+		auto t0 = std::chrono::steady_clock::now();
+		convert(stream_data, frame_size, stream_pcm);
+		double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (run == 0 || time < best_time) {
+			best_time = time;
+		}
+	}
+	return best_time;
+}
+
+/*
+* Wisdom lines are "<configuration> : <exec> <radix> <symmetric> <fp64>",
+* the last line for a configuration wins. Plans that could not be written
+* are kept for the process, so a read-only file does not replan every init.
+*/
+bool DSDPCMConverterEngine::load_wisdom(const char* plan_key) {
+	bool found = false;
+	FILE* wisdom = open_wisdom(wisdom_file, false);
+	if (wisdom) {
+		char line[256];
+		while (fgets(line, sizeof(line), wisdom)) {
+			found = read_wisdom(line, plan_key) || found;
+		}
+		fclose(wisdom);
+	}
+	std::lock_guard<std::mutex> lock(wisdom_lock);
+	for (size_t i = 0; i < wisdom_unsaved.size(); i++) {
+		found = read_wisdom(wisdom_unsaved[i].c_str(), plan_key) || found;
+	}
+	return found;
+}
+
+bool DSDPCMConverterEngine::read_wisdom(const char* line, const char* plan_key) {
+	int exec, radix, symmetric, fp64;
+	size_t key_length = strlen(plan_key);
+	if (strncmp(line, plan_key, key_length) != 0 || strncmp(line + key_length, " :", 2) != 0) {
+		return false;
+	}
+	if (sscanf(line + key_length + 2, "%d %d %d %d", &exec, &radix, &symmetric, &fp64) != 4) {
+		return false;
+	}
+	if (radix < 1 || radix > DSDPCM_RADIX_MAX) {
+		return false;
+	}
+	conv_exec = (exec == DSDPCM_EXEC_LANES) ? DSDPCM_EXEC_LANES : DSDPCM_EXEC_THREADS;
+	ctables_radix = radix;
+	ctables_symmetric = symmetric != 0;
+	conv_fp64 = conv_fp64 || fp64 != 0;
+	return true;
+}
+
+void DSDPCMConverterEngine::save_wisdom(const char* plan_key) {
+	char line[256];
+	snprintf(line, sizeof(line), "%s : %d %d %d %d\n", plan_key, (int)conv_exec, ctables_radix, ctables_symmetric, conv_fp64);
+	FILE* wisdom = open_wisdom(wisdom_file, true);
+	if (!wisdom) {
+		LOG(LOG_WARNING, ("Could not write DSD to PCM converter wisdom"));
+		std::lock_guard<std::mutex> lock(wisdom_lock);
+		wisdom_unsaved.push_back(line);
+		return;
+	}
+	fputs(line, wisdom);
+	fclose(wisdom);
+}
+
+int DSDPCMConverterEngine::trim_stream(void* pcm_data, int pcm_samples, int sample_bytes) {
+	int trim_samples = trim_pending * pcm_channels;
+	if (trim_samples > pcm_samples) {
+		trim_samples = pcm_samples;
+	}
+	if (trim_samples > 0) {
+		memmove(pcm_data, (uint8_t*)pcm_data + trim_samples * sample_bytes, (pcm_samples - trim_samples) * sample_bytes);
+		trim_pending -= trim_samples / pcm_channels;
+	}
+	return pcm_samples - trim_samples;
+}
+
+int DSDPCMConverterEngine::get_decimation(int& interpolation, int& resampler_decimation) {
+	int samplerate = pcm_samplerate;
+	interpolation = 1;
+	resampler_decimation = 1;
+	if (pcm_samplerate % DSDxFs1 != 0 && pcm_samplerate % PCMxFs48 == 0) {
+		interpolation = PCMxFs48_INTERPOLATION;
+		resampler_decimation = PCMxFs48_DECIMATION;
+		samplerate = pcm_samplerate / interpolation * resampler_decimation;
+	}
+	return dsd_samplerate / samplerate;
+}
+
+/*
+* With time split, slots of segment s follow the channel slots at s * channels.
+* A segment other than the first one runs split_prime frames ahead of its
+* start to rebuild the FIR histories of the whole cascade, so its output is
+* bit-identical to the sequential one.
+*/
 template<typename real_t>
 DSDPCMConverterSlot<real_t>* DSDPCMConverterEngine::init_slots(DSDPCMFilterSetup<real_t>& fltSetup) {
-	DSDPCMConverterSlot<real_t>* convSlots = new DSDPCMConverterSlot<real_t>[channels];
 	int dsd_samples = dsd_samplerate / 8 / framerate;
 	int pcm_samples = pcm_samplerate / framerate;
-	int decimation = dsd_samplerate / pcm_samplerate;
-	for (int ch = 0; ch < channels; ch++) {
+	int interpolation, resampler_decimation;
+	int decimation = get_decimation(interpolation, resampler_decimation);
+	split_segments = 1;
+	split_prime = 0;
+	int history_bytes = 0;
+	if (multirate_outputs == 0 && !conv_fft && interpolation == resampler_decimation) {
+		history_bytes = get_history_bytes(fltSetup, decimation);
+	}
+	if (time_split > 1 && history_bytes > 0) {
+		split_segments = time_split;
+		split_prime = (history_bytes + dsd_samples - 1) / dsd_samples;
+	}
+	DSDPCMConverterSlot<real_t>* convSlots = new DSDPCMConverterSlot<real_t>[channels * split_segments];
+	if (multirate_outputs > 0) {
+		pcm_samples = 0;
+		for (int i = 0; i < multirate_outputs; i++) {
+			pcm_samples += multirate_samplerates[i] / framerate;
+		}
+	}
+	for (int ch = 0; ch < channels * split_segments; ch++) {
 		DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 		slot->dsd_data = (uint8_t*)DSDPCMUtil::mem_alloc(dsd_samples * sizeof(uint8_t));
 		slot->dsd_samples = dsd_samples;
 		slot->pcm_data = (real_t*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(real_t));
 		slot->pcm_samples = 0;
+		slot->channel = ch % channels;
+		slot->channels = channels;
+		slot->silence_settle = history_bytes;
 		switch (conv_type) {
 		case DSDPCM_CONV_MULTISTAGE:
+		case DSDPCM_CONV_LOWLATENCY:
 		{
 			DSDPCMConverterMultistage<real_t>* pConv = nullptr;
+			if (multirate_outputs > 0) {
+				slot->converter = new DSDPCMConverterMultirate<real_t>(multirate_decimation, multirate_outputs);
+				break;
+			}
 			switch (decimation) {
 			case 512:
 				pConv = new DSDPCMConverterMultistage_x512<real_t>();
@@ -194,7 +935,6 @@ DSDPCMConverterSlot<real_t>* DSDPCMConverterEngine::init_slots(DSDPCMFilterSetup
 				pConv = new DSDPCMConverterMultistage_x8<real_t>();
 				break;
 			}
-			pConv->init(fltSetup, dsd_samples);
 			slot->converter = pConv;
 			break;
 		}
@@ -202,6 +942,10 @@ DSDPCMConverterSlot<real_t>* DSDPCMConverterEngine::init_slots(DSDPCMFilterSetup
 		case DSDPCM_CONV_USER:
 		{
 			DSDPCMConverterDirect<real_t>* pConv = nullptr;
+			if (conv_fft) {
+				slot->converter = new_converter_fft<real_t>(decimation);
+				break;
+			}
 			switch (decimation) {
 			case 512:
 				pConv = new DSDPCMConverterDirect_x512<real_t>();
@@ -225,13 +969,23 @@ DSDPCMConverterSlot<real_t>* DSDPCMConverterEngine::init_slots(DSDPCMFilterSetup
 				pConv = new DSDPCMConverterDirect_x8<real_t>();
 				break;
 			}
-			pConv->init(fltSetup, dsd_samples);
 			slot->converter = pConv;
 			break;
 		}
 		default:
 			break;
 		}
+		if (slot->converter && interpolation != resampler_decimation) {
+			slot->converter = new DSDPCMConverterPolyphase<real_t>(slot->converter, decimation, interpolation, resampler_decimation);
+		}
+		if (slot->converter) {
+			slot->converter->init(fltSetup, dsd_samples);
+		}
+		if (slot->converter && multirate_outputs > 0) {
+			for (int i = 0; i < multirate_outputs; i++) {
+				multirate_delay[i] = static_cast<DSDPCMConverterMultirate<real_t>*>(slot->converter)->get_delay(i);
+			}
+		}
 		slot->run_slot = true;
 		slot->hEventGet = CreateEvent(NULL, FALSE, FALSE, NULL);
 		slot->hEventPut = CreateEvent(NULL, FALSE, FALSE, NULL);
@@ -242,7 +996,7 @@ DSDPCMConverterSlot<real_t>* DSDPCMConverterEngine::init_slots(DSDPCMFilterSetup
 
 template<typename real_t>
 void DSDPCMConverterEngine::free_slots(DSDPCMConverterSlot<real_t>* convSlots) {
-	for (int ch = 0; ch < channels; ch++) {
+	for (int ch = 0; ch < channels * split_segments; ch++) {
 		DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 		slot->run_slot = false;
 		SetEvent(slot->hEventPut); // Release worker (decoding) thread for exit
@@ -268,7 +1022,7 @@ void DSDPCMConverterEngine::free_slots(DSDPCMConverterSlot<real_t>* convSlots) {
 }
 
 template<typename real_t>
-int DSDPCMConverterEngine::convert(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples, float* pcm_data) {
+int DSDPCMConverterEngine::convert(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples, void* pcm_data, pcm_format_e pcm_format) {
 	int pcm_samples = 0;
 	for (int ch = 0; ch < channels; ch++)	{
 		DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
@@ -281,50 +1035,124 @@ int DSDPCMConverterEngine::convert(DSDPCMConverterSlot<real_t>* convSlots, uint8
 	for (int ch = 0; ch < channels; ch++)	{
 		DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 		WaitForSingleObject(slot->hEventGet, INFINITE);	// Wait until worker (decoding) thread is complete
-		for (int sample = 0; sample < slot->pcm_samples; sample++)	{
-			pcm_data[sample * channels + ch] = (float)slot->pcm_data[sample];
-		}
+		quantizer.run<real_t>(pcm_format, ch, slot->pcm_data, 1, slot->pcm_samples, get_gain<real_t>(), pcm_data);
 		pcm_samples += slot->pcm_samples;
 	}
 	return pcm_samples;
 }
 
 template<typename real_t>
-int DSDPCMConverterEngine::convertL(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples) {
-	for (int ch = 0; ch < channels; ch++)	{
-		DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
-		slot->dsd_samples = dsd_samples / channels;
-		for (int sample = 0; sample < slot->dsd_samples; sample++)	{
-			slot->dsd_data[sample] = swap_bits[dsd_data[(slot->dsd_samples - 1 - sample) * channels + ch]];
+int DSDPCMConverterEngine::convert_batch(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_frames, float* pcm_data) {
+	int pcm_samples = 0;
+	int frame_size = dsd_samplerate / 8 / framerate * channels;
+	int pcm_frame = pcm_samplerate / framerate * channels;
+	int segments = split_segments;
+	if (segments > 1 && dsd_frames < segments * split_prime) {
+		segments = dsd_frames / split_prime;
+	}
+	if (segments < 1) {
+		segments = 1;
+	}
+	for (int segment = 0; segment < segments; segment++) {
+		int frame_begin = dsd_frames * segment / segments;
+		int frame_end = dsd_frames * (segment + 1) / segments;
+		int prime_frames = (segment > 0) ? split_prime : 0;
+		for (int ch = 0; ch < channels; ch++)	{
+			DSDPCMConverterSlot<real_t>* slot = &convSlots[segment * channels + ch];
+			slot->dsd_samples = dsd_samplerate / 8 / framerate;
+			slot->batch_dsd_data = dsd_data + (frame_begin - prime_frames) * frame_size;
+			slot->batch_pcm_data = pcm_data + frame_begin * pcm_frame;
+			slot->batch_frames = frame_end - frame_begin + prime_frames;
+			slot->batch_skip = prime_frames;
+			if (prime_frames > 0) {
+				slot->silence_bytes = 0;
+			}
+			slot->batch_gain = get_gain<real_t>();
+			SetEvent(slot->hEventPut); // Release worker (decoding) thread on the whole batch
 		}
-		SetEvent(convSlots[ch].hEventPut); // Release worker (decoding) thread on the loaded slot
 	}
-	for (int ch = 0; ch < channels; ch++)	{
+	for (int ch = 0; ch < channels * segments; ch++)	{
 		DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 		WaitForSingleObject(slot->hEventGet, INFINITE);	// Wait until worker (decoding) thread is complete
+		slot->batch_dsd_data = nullptr;
+		slot->batch_pcm_data = nullptr;
+		slot->batch_frames = 0;
+		slot->batch_skip = 0;
+		pcm_samples += slot->pcm_samples;
 	}
-	return 0;
+	if (segments > 1) {
+		// the last segment's converters hold the history the next call continues from
+		for (int ch = 0; ch < channels; ch++) {
+			DSDPCMConverterSlot<real_t>* last = &convSlots[(segments - 1) * channels + ch];
+			DSDPCMConverter<real_t>* converter = convSlots[ch].converter;
+			convSlots[ch].converter = last->converter;
+			convSlots[ch].silence_bytes = last->silence_bytes;
+			convSlots[ch].silence_dsd_samples = last->silence_dsd_samples;
+			convSlots[ch].silence_pcm_samples = last->silence_pcm_samples;
+			convSlots[ch].silence_level = last->silence_level;
+			last->converter = converter;
+		}
+	}
+	return pcm_samples;
 }
 
 template<typename real_t>
-int DSDPCMConverterEngine::convertR(DSDPCMConverterSlot<real_t>* convSlots, float* pcm_data) {
-	int pcm_samples = 0;
+int DSDPCMConverterEngine::convert_multirate(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples, float** pcm_data, int* pcm_samples) {
+	int out_samples = 0;
 	for (int ch = 0; ch < channels; ch++)	{
 		DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
-		for (int sample = 0; sample < slot->dsd_samples / 2; sample++)	{
-			uint8_t temp = slot->dsd_data[slot->dsd_samples - 1 - sample];
-			slot->dsd_data[slot->dsd_samples - 1 - sample] = swap_bits[slot->dsd_data[sample]];
-			slot->dsd_data[sample] = swap_bits[temp];
+		slot->dsd_samples = dsd_samples / channels;
+		for (int sample = 0; sample < slot->dsd_samples; sample++)	{
+			slot->dsd_data[sample] = dsd_data[sample * channels + ch];
 		}
-		SetEvent(convSlots[ch].hEventPut); // Release worker (decoding) thread on the loaded slot
+		SetEvent(slot->hEventPut); // Release worker (decoding) thread on the loaded slot
+	}
+	for (int i = 0; i < multirate_outputs; i++) {
+		pcm_samples[i] = 0;
 	}
 	for (int ch = 0; ch < channels; ch++)	{
 		DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 		WaitForSingleObject(slot->hEventGet, INFINITE);	// Wait until worker (decoding) thread is complete
-		for (int sample = 0; sample < slot->pcm_samples; sample++)	{
-			pcm_data[sample * channels + ch] = (float)slot->pcm_data[sample];
+		real_t* out_data = slot->pcm_data;
+		for (int i = 0; i < multirate_outputs; i++) {
+			int samples = slot->dsd_samples * 8 / multirate_decimation[i];
+			for (int sample = 0; sample < samples; sample++)	{
+				pcm_data[i][sample * channels + ch] = (float)(out_data[sample] * get_gain<real_t>());
+			}
+			out_data += samples;
+			pcm_samples[i] += samples;
 		}
-		pcm_samples += slot->pcm_samples;
+		out_samples += slot->pcm_samples;
 	}
-	return pcm_samples;
+	return out_samples;
+}
+
+template<typename real_t>
+DSDPCMConverterLanes<real_t>* DSDPCMConverterEngine::init_lanes(DSDPCMFilterSetup<real_t>& fltSetup) {
+	DSDPCMConverterLanes<real_t>* convLanes = new DSDPCMConverterLanes<real_t>();
+	int dsd_samples = dsd_samplerate / 8 / framerate;
+	int interpolation, resampler_decimation;
+	int decimation = get_decimation(interpolation, resampler_decimation);
+	if (init_downmix) {
+		convLanes->set_downmix(init_downmix_matrix, channels, pcm_channels);
+	}
+	if (interpolation == resampler_decimation) {
+		convLanes->set_silence_settle(get_history_bytes(fltSetup, decimation));
+	}
+	if (!convLanes->init(fltSetup, conv_type, decimation, channels, dsd_samples, interpolation, resampler_decimation)) {
+		delete convLanes;
+		return nullptr;
+	}
+	return convLanes;
+}
+
+template<typename real_t>
+int DSDPCMConverterEngine::convert(DSDPCMConverterLanes<real_t>* convLanes, uint8_t* dsd_data, int dsd_samples, void* pcm_data, pcm_format_e pcm_format) {
+	convLanes->dsd_samples = dsd_samples / channels;
+	memcpy(convLanes->dsd_data, dsd_data, convLanes->dsd_samples * channels);
+	convLanes->pcm_samples = convLanes->convert(convLanes->dsd_data, convLanes->pcm_data, convLanes->dsd_samples);
+	for (int ch = 0; ch < pcm_channels; ch++) {
+		quantizer.run<real_t>(pcm_format, ch, convLanes->pcm_data + ch, pcm_channels, convLanes->pcm_samples, get_gain<real_t>(), pcm_data);
+	}
+	return convLanes->pcm_samples * pcm_channels;
 }
@@ -20,8 +20,13 @@
 #pragma once
 
 #include <windows.h>
+#include <string>
 #include "DSDPCMConverterMultistage.h"
 #include "DSDPCMConverterDirect.h"
+#include "DSDPCMConverterLanes.h"
+#include "DSDPCMConverterPolyphase.h"
+#include "DSDPCMConverterMultirate.h"
+#include "DSDPCMQuantizer.h"
 
 template<typename real_t>
 class DSDPCMConverterSlot {
@@ -30,6 +35,18 @@ public:
 	int      dsd_samples;
 	real_t*  pcm_data;
 	int      pcm_samples;
+	uint8_t* batch_dsd_data;
+	float*   batch_pcm_data;
+	int      batch_frames;
+	int      batch_skip;
+	double   batch_gain;
+	int      silence_settle;
+	int      silence_bytes;
+	int      silence_dsd_samples;
+	int      silence_pcm_samples;
+	real_t   silence_level;
+	int      channel;
+	int      channels;
 	bool     run_slot;
 	DSDPCMConverter<real_t>* converter;
 	HANDLE hThread;
@@ -40,6 +57,18 @@ public:
 		dsd_samples = 0;
 		pcm_data = nullptr;
 		pcm_samples = 0;
+		batch_dsd_data = nullptr;
+		batch_pcm_data = nullptr;
+		batch_frames = 0;
+		batch_skip = 0;
+		batch_gain = 1.0;
+		silence_settle = 0;
+		silence_bytes = 0;
+		silence_dsd_samples = 0;
+		silence_pcm_samples = 0;
+		silence_level = 0;
+		channel = 0;
+		channels = 0;
 		run_slot = false;
 		converter = nullptr;
 		hThread = NULL;
@@ -54,28 +83,107 @@ class DSDPCMConverterEngine {
 	int   dsd_samplerate;
 	int   pcm_samplerate;
 	float dB_gain;
+	double conv_gain;
+	int   ctables_radix;
+	bool  ctables_fp32;
+	bool  ctables_symmetric;
+	int   ctables_planes;
 	float conv_delay;
 	conv_type_e conv_type;
+	conv_exec_e conv_exec;
+	conv_exec_e init_exec;
 	bool        conv_fp64;
-	bool        conv_called;
+	bool        conv_fixed;
+	bool        conv_mixed;
+	bool        conv_fft;
+	bool        delay_trim;
+	int         trim_delay;
+	int         trim_pending;
+	int         multirate_outputs;
+	int         multirate_samplerates[DSDPCM_MAX_OUTPUTS];
+	int         multirate_decimation[DSDPCM_MAX_OUTPUTS];
+	float       multirate_delay[DSDPCM_MAX_OUTPUTS];
+	int         downmix_channels;
+	int         downmix_pcm_channels;
+	double      downmix_matrix[DSDPCM_MAX_CHANNELS * DSDPCM_MAX_CHANNELS];
+	bool        init_downmix;
+	double      init_downmix_matrix[DSDPCM_MAX_CHANNELS * DSDPCM_MAX_CHANNELS];
+	int         pcm_channels;
+	pcm_format_e pcm_format;
+	bool        pcm_dither;
+	bool        pcm_noise_shaping;
+	DSDPCMQuantizer quantizer;
+	std::string wisdom_file;
+	bool        wisdom_plan;
+	DSDPCMArena arena;
+	int         time_split;
+	int         split_segments;
+	int         split_prime;
 	DSDPCMFilterSetup<float>     fltSetup_fp32;
 	DSDPCMFilterSetup<double>    fltSetup_fp64;
+	DSDPCMFilterSetup<int32_t>   fltSetup_int32;
 	DSDPCMConverterSlot<float>*  convSlots_fp32;
 	DSDPCMConverterSlot<double>* convSlots_fp64;
-	uint8_t swap_bits[256];
+	DSDPCMConverterSlot<int32_t>* convSlots_int32;
+	DSDPCMConverterLanes<float>*  convLanes_fp32;
+	DSDPCMConverterLanes<double>* convLanes_fp64;
+	DSDPCMConverterLanes<int32_t>* convLanes_int32;
+	uint8_t* stream_data;
+	int      stream_size;
+	int64_t  stream_in;
+	int64_t  stream_out;
+	float*   stream_pcm;
 public:
 	DSDPCMConverterEngine();
 	~DSDPCMConverterEngine();
 	float get_delay();
+	float get_stream_delay();
+	float get_multirate_delay(int output);
+	int get_pcm_channels();
 	void set_gain(float dB_gain);
-	bool is_convert_called();
+	void set_exec_mode(conv_exec_e conv_exec);
+	void set_fixed_point(bool conv_fixed);
+	void set_mixed_precision(bool conv_mixed);
+	void set_ctables_layout(int radix, bool fp32, bool symmetric);
+	void set_ctables_planes(int planes);
+	void set_delay_trim(bool delay_trim);
+	void set_multirate(int* pcm_samplerates, int outputs);
+	void set_downmix(const double* matrix, int channels, int pcm_channels);
+	void set_output_format(pcm_format_e pcm_format, bool dither, bool noise_shaping);
+	void set_wisdom(const char* wisdom_file, bool wisdom_plan = true);
+	void set_huge_pages(arena_pages_e pages);
+	void set_time_split(int segments);
 	int init(int channels, int framerate, int dsd_samplerate, int pcm_samplerate, conv_type_e conv_type, bool conv_fp64, double* fir_coefs, int fir_length, bool skip_init);
 	int free();
 	int convert(uint8_t* dsd_data, int dsd_samples, float* pcm_data);
+	int convert_pcm(uint8_t* dsd_data, int dsd_samples, uint8_t* pcm_data);
+	int convert_batch(uint8_t* dsd_data, int dsd_samples, float* pcm_data);
+	int convert_stream(uint8_t* dsd_data, int dsd_samples, float* pcm_data);
+	int convert_stream_pcm(uint8_t* dsd_data, int dsd_samples, uint8_t* pcm_data);
+	void reset_stream();
+	int convert_multirate(uint8_t* dsd_data, int dsd_samples, float** pcm_data, int* pcm_samples);
 private:
+	int init_converter(double* fir_coefs, int fir_length);
+	int convert_format(uint8_t* dsd_data, int dsd_samples, void* pcm_data, pcm_format_e pcm_format);
+	int convert_stream(uint8_t* dsd_data, int dsd_samples, void* pcm_data, pcm_format_e pcm_format);
+	void plan(double* fir_coefs, int fir_length);
+	double time_converter();
+	bool load_wisdom(const char* plan_key);
+	bool read_wisdom(const char* line, const char* plan_key);
+	void save_wisdom(const char* plan_key);
+	int get_decimation(int& interpolation, int& resampler_decimation);
+	int trim_stream(void* pcm_data, int pcm_samples, int sample_bytes);
+	template<typename real_t> double get_gain() {
+		return conv_gain * DSDPCMSample<real_t>::get_unit();
+	}
+	template<typename real_t> int get_history_bytes(DSDPCMFilterSetup<real_t>& fltSetup, int decimation) {
+		return (fltSetup.get_fir1_64_length() + (PCMFIR2_2_LENGTH + PCMFIR3_2_LENGTH) * decimation) / 8 + 1;
+	}
 	template<typename real_t> DSDPCMConverterSlot<real_t>* init_slots(DSDPCMFilterSetup<real_t>& fltSetup);
 	template<typename real_t> void free_slots(DSDPCMConverterSlot<real_t>* convSlots);
-	template<typename real_t> int convert(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples, float* pcm_data);
-	template<typename real_t> int convertL(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples);
-	template<typename real_t> int convertR(DSDPCMConverterSlot<real_t>* convSlots, float* pcm_data);
+	template<typename real_t> int convert(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples, void* pcm_data, pcm_format_e pcm_format = DSDPCM_PCM_FLOAT32);
+	template<typename real_t> int convert_batch(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_frames, float* pcm_data);
+	template<typename real_t> int convert_multirate(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples, float** pcm_data, int* pcm_samples);
+	template<typename real_t> DSDPCMConverterLanes<real_t>* init_lanes(DSDPCMFilterSetup<real_t>& fltSetup);
+	template<typename real_t> int convert(DSDPCMConverterLanes<real_t>* convLanes, uint8_t* dsd_data, int dsd_samples, void* pcm_data, pcm_format_e pcm_format = DSDPCM_PCM_FLOAT32);
 };
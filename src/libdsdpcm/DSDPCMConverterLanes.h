@@ -0,0 +1,286 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "DSDPCMConverter.h"
+#include "DSDPCMFirLanes.h"
+#include "PCMPCMFirLanes.h"
+#include "PCMPCMResampler.h"
+
+#define DSDPCM_MAX_PCM_STAGES 5
+
+/*
+* Single-thread converter for all channels of an interleaved DSD stream.
+* Builds the same filter cascade as DSDPCMConverterMultistage_xN /
+* DSDPCMConverterDirect_xN, so the per-channel output is identical.
+* With a downmix matrix set, the channels are mixed right after the first
+* stage; the cascade is linear and the same for every channel, so the later
+* stages only run for the mixed channels.
+* With a settle length set, frames of idle pattern in every channel repeat
+* the settled levels once that many bytes of it have passed, as the engine
+* slots do; the resampler output is not constant, it always converts.
+*/
+
+template<typename real_t>
+class DSDPCMConverterLanes {
+	using accum_t = typename DSDPCMSample<real_t>::accum_t;
+	int      channels;
+	int      pcm_channels;
+	real_t   downmix_coefs[DSDPCM_MAX_CHANNELS * DSDPCM_MAX_CHANNELS];
+	bool     downmix;
+	float    delay;
+	DSDPCMFirLanes<real_t> dsd_fir1;
+	PCMPCMFirLanes<real_t> pcm_fir[DSDPCM_MAX_PCM_STAGES];
+	int      pcm_stages;
+	PCMPCMResampler<real_t> pcm_resampler;
+	bool     pcm_resample;
+	real_t*  pcm_temp1;
+	real_t*  pcm_temp2;
+	real_t*  pcm_temp3;
+	real_t*  pcm_temp0;
+	int      silence_settle;
+	int      silence_bytes;
+	int      silence_dsd_samples;
+	int      silence_pcm_samples;
+	real_t   silence_level[DSDPCM_MAX_CHANNELS];
+public:
+	uint8_t* dsd_data;
+	int      dsd_samples;
+	real_t*  pcm_data;
+	int      pcm_samples;
+	DSDPCMConverterLanes() {
+		channels = 0;
+		pcm_channels = 0;
+		downmix = false;
+		delay = 0.0f;
+		pcm_stages = 0;
+		pcm_resample = false;
+		pcm_temp1 = nullptr;
+		pcm_temp2 = nullptr;
+		pcm_temp3 = nullptr;
+		pcm_temp0 = nullptr;
+		silence_settle = 0;
+		silence_bytes = 0;
+		silence_dsd_samples = 0;
+		silence_pcm_samples = 0;
+		dsd_data = nullptr;
+		dsd_samples = 0;
+		pcm_data = nullptr;
+		pcm_samples = 0;
+	}
+	~DSDPCMConverterLanes() {
+		DSDPCMUtil::mem_free(pcm_temp1);
+		DSDPCMUtil::mem_free(pcm_temp2);
+		DSDPCMUtil::mem_free(pcm_temp3);
+		DSDPCMUtil::mem_free(pcm_temp0);
+		DSDPCMUtil::mem_free(dsd_data);
+		DSDPCMUtil::mem_free(pcm_data);
+	}
+	float get_delay() {
+		return delay;
+	}
+	int get_channels() {
+		return channels;
+	}
+	int get_pcm_channels() {
+		return pcm_channels;
+	}
+	/*
+	* Row-major pcm_channels x channels matrix, set before init. Entries are
+	* gains below DSDPCM_MAX_GAIN in magnitude.
+	*/
+	void set_downmix(const double* matrix, int channels, int pcm_channels) {
+		downmix = matrix && channels > 0 && pcm_channels > 0;
+		if (downmix) {
+			for (int i = 0; i < pcm_channels * channels; i++) {
+				downmix_coefs[i] = DSDPCMSample<real_t>::make_gain(matrix[i]);
+			}
+			this->pcm_channels = pcm_channels;
+		}
+	}
+	bool init(DSDPCMFilterSetup<real_t>& flt_setup, conv_type_e conv_type, int decimation, int channels, int dsd_samples, int interpolation = 1, int resampler_decimation = 1, int resampler_taps = PCMxFs48_TAPS) {
+		this->channels = channels;
+		if (!downmix) {
+			this->pcm_channels = channels;
+		}
+		pcm_stages = 0;
+		int fir2_stages = 0;
+		bool fir3_stage = false;
+		switch (conv_type) {
+		case DSDPCM_CONV_MULTISTAGE:
+		case DSDPCM_CONV_LOWLATENCY:
+			switch (decimation) {
+			case 512:
+			case 256:
+			case 128:
+			case 64:
+				dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16, channels);
+				fir2_stages = (decimation == 512) ? 4 : (decimation == 256) ? 3 : (decimation == 128) ? 2 : 1;
+				fir3_stage = true;
+				break;
+			case 32:
+				dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8, channels);
+				fir2_stages = 1;
+				fir3_stage = true;
+				break;
+			case 16:
+				dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8, channels);
+				fir3_stage = true;
+				break;
+			case 8:
+				dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8, channels);
+				break;
+			default:
+				return false;
+			}
+			break;
+		case DSDPCM_CONV_DIRECT:
+		case DSDPCM_CONV_USER:
+			switch (decimation) {
+			case 512:
+			case 256:
+			case 128:
+				dsd_fir1.init(flt_setup.get_fir1_64_ctables(), flt_setup.get_fir1_64_length(), 64, channels);
+				fir2_stages = (decimation == 512) ? 2 : (decimation == 256) ? 1 : 0;
+				fir3_stage = true;
+				break;
+			case 64:
+				dsd_fir1.init(flt_setup.get_fir1_64_ctables(), flt_setup.get_fir1_64_length(), 32, channels);
+				fir3_stage = true;
+				break;
+			case 32:
+			case 16:
+			case 8:
+				dsd_fir1.init(flt_setup.get_fir1_64_ctables(), flt_setup.get_fir1_64_length(), decimation, channels);
+				break;
+			default:
+				return false;
+			}
+			break;
+		default:
+			return false;
+		}
+		for (int i = 0; i < fir2_stages; i++) {
+			pcm_fir[pcm_stages++].init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, pcm_channels);
+		}
+		if (fir3_stage) {
+			pcm_fir[pcm_stages++].init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, pcm_channels, flt_setup.get_pcm_sum_fp64());
+		}
+		delay = dsd_fir1.get_delay();
+		for (int i = 0; i < pcm_stages; i++) {
+			delay = delay / pcm_fir[i].get_decimation() + pcm_fir[i].get_delay();
+		}
+		int fir1_samples = dsd_samples / dsd_fir1.get_decimation();
+		int out_samples = dsd_samples * 8 / decimation;
+		pcm_resample = interpolation != resampler_decimation;
+		if (pcm_resample) {
+			pcm_resampler.init(interpolation, resampler_decimation, resampler_taps, pcm_channels, flt_setup.get_pcm_sum_fp64());
+			delay = delay * interpolation / resampler_decimation + pcm_resampler.get_delay();
+			pcm_temp3 = (real_t*)DSDPCMUtil::mem_alloc(out_samples * pcm_channels * sizeof(real_t));
+			out_samples = pcm_resampler.get_samples(out_samples);
+		}
+		this->dsd_data = (uint8_t*)DSDPCMUtil::mem_alloc(dsd_samples * channels * sizeof(uint8_t));
+		this->dsd_samples = dsd_samples;
+		this->pcm_data = (real_t*)DSDPCMUtil::mem_alloc(out_samples * pcm_channels * sizeof(real_t));
+		this->pcm_samples = 0;
+		if (downmix) {
+			pcm_temp0 = (real_t*)DSDPCMUtil::mem_alloc(fir1_samples * channels * sizeof(real_t));
+		}
+		if (pcm_stages > 0) {
+			pcm_temp1 = (real_t*)DSDPCMUtil::mem_alloc(fir1_samples * pcm_channels * sizeof(real_t));
+		}
+		if (pcm_stages > 1) {
+			pcm_temp2 = (real_t*)DSDPCMUtil::mem_alloc(fir1_samples / 2 * pcm_channels * sizeof(real_t));
+		}
+		return true;
+	}
+	void set_silence_settle(int settle_bytes) {
+		silence_settle = settle_bytes;
+		silence_bytes = 0;
+	}
+	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		if (pcm_resample) {
+			int pcm_samples = convert_cascade(dsd_data, pcm_temp3, dsd_samples);
+			return pcm_resampler.run(pcm_temp3, pcm_data, pcm_samples);
+		}
+		bool silent = silence_settle > 0 && DSDPCMUtil::is_silence(dsd_data, dsd_samples * channels);
+		if (silent && silence_bytes >= silence_settle && dsd_samples == silence_dsd_samples) {
+			for (int sample = 0; sample < silence_pcm_samples; sample++) {
+				for (int ch = 0; ch < pcm_channels; ch++) {
+					pcm_data[sample * pcm_channels + ch] = silence_level[ch];
+				}
+			}
+			return silence_pcm_samples;
+		}
+		int pcm_samples = convert_cascade(dsd_data, pcm_data, dsd_samples);
+		if (!silent) {
+			silence_bytes = 0;
+			return pcm_samples;
+		}
+		if (silence_bytes < silence_settle) {
+			silence_bytes += dsd_samples;
+		}
+		if (silence_bytes >= silence_settle && pcm_samples > 0) {
+			silence_dsd_samples = dsd_samples;
+			silence_pcm_samples = pcm_samples;
+			for (int ch = 0; ch < pcm_channels; ch++) {
+				silence_level[ch] = pcm_data[(pcm_samples - 1) * pcm_channels + ch];
+			}
+		}
+		return pcm_samples;
+	}
+private:
+	int convert_cascade(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		int pcm_samples;
+		if (pcm_stages == 0) {
+			return run_fir1(dsd_data, pcm_data, dsd_samples);
+		}
+		pcm_samples = run_fir1(dsd_data, pcm_temp1, dsd_samples);
+		real_t* pcm_inp = pcm_temp1;
+		real_t* pcm_out = pcm_temp2;
+		for (int i = 0; i < pcm_stages - 1; i++) {
+			pcm_samples = pcm_fir[i].run(pcm_inp, pcm_out, pcm_samples);
+			real_t* pcm_tmp = pcm_inp;
+			pcm_inp = pcm_out;
+			pcm_out = pcm_tmp;
+		}
+		pcm_samples = pcm_fir[pcm_stages - 1].run(pcm_inp, pcm_data, pcm_samples);
+		return pcm_samples;
+	}
+	int run_fir1(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		if (!downmix) {
+			return dsd_fir1.run(dsd_data, pcm_data, dsd_samples);
+		}
+		int pcm_samples = dsd_fir1.run(dsd_data, pcm_temp0, dsd_samples);
+		for (int sample = 0; sample < pcm_samples; sample++) {
+			const real_t* inp = pcm_temp0 + sample * channels;
+			real_t* out = pcm_data + sample * pcm_channels;
+			for (int och = 0; och < pcm_channels; och++) {
+				const real_t* coefs = downmix_coefs + och * channels;
+				accum_t mix = 0;
+				for (int ch = 0; ch < channels; ch++) {
+					mix += DSDPCMSample<real_t>::mul(coefs[ch], inp[ch]);
+				}
+				out[och] = DSDPCMSample<real_t>::from_gain(mix);
+			}
+		}
+		return pcm_samples;
+	}
+};
@@ -0,0 +1,156 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "DSDPCMConverter.h"
+
+#define DSDPCM_MAX_OUTPUTS      4
+#define DSDPCM_MULTIRATE_LEVELS 5
+
+/*
+* Multistage cascade with several PCM outputs from one pass. Outputs of x8..x32
+* share the dsd_fir1 x8 trunk, outputs of x64..x512 the dsd_fir1 x16 trunk; the
+* half band pcm_fir2 chain of a trunk runs once, down to the deepest output, and
+* every output taps it through its own pcm_fir3. Each output is identical to the
+* DSDPCMConverterMultistage_xN output. The outputs are written back to back in
+* the order given, output i holding dsd_samples * 8 / decimation[i] samples.
+*/
+
+template<typename real_t>
+class DSDPCMConverterMultirate : public DSDPCMConverter<real_t> {
+	int outputs;
+	int out_decimation[DSDPCM_MAX_OUTPUTS];
+	int out_trunk[DSDPCM_MAX_OUTPUTS];
+	int out_level[DSDPCM_MAX_OUTPUTS];
+	float out_delay[DSDPCM_MAX_OUTPUTS];
+	PCMPCMFir<real_t> pcm_fir3[DSDPCM_MAX_OUTPUTS];
+	int trunk_levels[2];
+	DSDPCMFir<real_t> dsd_fir1[2];
+	PCMPCMFir<real_t> pcm_fir2[2][DSDPCM_MULTIRATE_LEVELS - 1];
+	real_t* trunk_data[2][DSDPCM_MULTIRATE_LEVELS];
+	int block_samples;
+public:
+	DSDPCMConverterMultirate(int* decimation, int outputs) {
+		this->outputs = outputs;
+		trunk_levels[0] = trunk_levels[1] = -1;
+		for (int i = 0; i < outputs; i++) {
+			int trunk = (decimation[i] > 32) ? 1 : 0;
+			int level = -1;
+			for (int d = trunk ? 32 : 16; d <= decimation[i]; d *= 2) {
+				level++;
+			}
+			out_decimation[i] = decimation[i];
+			out_trunk[i] = trunk;
+			out_level[i] = level;
+			if (trunk_levels[trunk] < level) {
+				trunk_levels[trunk] = level;
+			}
+			if (trunk_levels[trunk] < 0) {
+				trunk_levels[trunk] = 0;
+			}
+		}
+		for (int trunk = 0; trunk < 2; trunk++) {
+			for (int level = 0; level < DSDPCM_MULTIRATE_LEVELS; level++) {
+				trunk_data[trunk][level] = nullptr;
+			}
+		}
+		block_samples = 0;
+	}
+	~DSDPCMConverterMultirate() {
+		for (int trunk = 0; trunk < 2; trunk++) {
+			for (int level = 0; level < DSDPCM_MULTIRATE_LEVELS; level++) {
+				DSDPCMUtil::mem_free(trunk_data[trunk][level]);
+			}
+		}
+	}
+	int get_outputs() {
+		return outputs;
+	}
+	float get_delay(int output) {
+		return out_delay[output];
+	}
+	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
+		block_samples = DSDPCM_FUSED_SAMPLES * 16 / 8;
+		if (block_samples > dsd_samples) {
+			block_samples = dsd_samples;
+		}
+		float trunk_delay[2][DSDPCM_MULTIRATE_LEVELS];
+		for (int trunk = 0; trunk < 2; trunk++) {
+			if (trunk_levels[trunk] < 0) {
+				continue;
+			}
+			if (trunk) {
+				dsd_fir1[trunk].init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
+			}
+			else {
+				dsd_fir1[trunk].init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
+			}
+			int pcm_samples = block_samples * 8 / (trunk ? 16 : 8);
+			trunk_data[trunk][0] = (real_t*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(real_t));
+			trunk_delay[trunk][0] = dsd_fir1[trunk].get_delay();
+			for (int level = 1; level <= trunk_levels[trunk]; level++) {
+				PCMPCMFir<real_t>& fir2 = pcm_fir2[trunk][level - 1];
+				fir2.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
+				pcm_samples /= 2;
+				trunk_data[trunk][level] = (real_t*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(real_t));
+				trunk_delay[trunk][level] = trunk_delay[trunk][level - 1] / fir2.get_decimation() + fir2.get_delay();
+			}
+		}
+		for (int i = 0; i < outputs; i++) {
+			if (out_level[i] < 0) {
+				out_delay[i] = trunk_delay[out_trunk[i]][0];
+				continue;
+			}
+			pcm_fir3[i].init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+			out_delay[i] = trunk_delay[out_trunk[i]][out_level[i]] / pcm_fir3[i].get_decimation() + pcm_fir3[i].get_delay();
+		}
+		this->delay = out_delay[0];
+	}
+	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		real_t* out_data[DSDPCM_MAX_OUTPUTS];
+		int pcm_samples = 0;
+		for (int i = 0; i < outputs; i++) {
+			out_data[i] = pcm_data + pcm_samples;
+			pcm_samples += dsd_samples * 8 / out_decimation[i];
+		}
+		int trunk_samples[2][DSDPCM_MULTIRATE_LEVELS];
+		for (int offset = 0; offset < dsd_samples; offset += block_samples) {
+			int samples = (dsd_samples - offset < block_samples) ? dsd_samples - offset : block_samples;
+			for (int trunk = 0; trunk < 2; trunk++) {
+				if (trunk_levels[trunk] < 0) {
+					continue;
+				}
+				trunk_samples[trunk][0] = dsd_fir1[trunk].run(dsd_data + offset, trunk_data[trunk][0], samples);
+				for (int level = 1; level <= trunk_levels[trunk]; level++) {
+					trunk_samples[trunk][level] = pcm_fir2[trunk][level - 1].run(trunk_data[trunk][level - 1], trunk_data[trunk][level], trunk_samples[trunk][level - 1]);
+				}
+			}
+			for (int i = 0; i < outputs; i++) {
+				if (out_level[i] < 0) {
+					memcpy(out_data[i], trunk_data[out_trunk[i]][0], trunk_samples[out_trunk[i]][0] * sizeof(real_t));
+					out_data[i] += trunk_samples[out_trunk[i]][0];
+					continue;
+				}
+				out_data[i] += pcm_fir3[i].run(trunk_data[out_trunk[i]][out_level[i]], out_data[i], trunk_samples[out_trunk[i]][out_level[i]]);
+			}
+		}
+		return pcm_samples;
+	}
+};
@@ -21,8 +21,41 @@
 
 #include "DSDPCMConverter.h"
 
+/*
+* Multistage cascades run in fused blocks of DSDPCM_FUSED_SAMPLES first stage
+* outputs: every block passes the whole stage chain before the next one starts,
+* so the intermediate buffers are block sized and stay in L1. The FIR stages
+* keep their own history, so the output is identical to whole frame runs.
+*/
+
 template<typename real_t>
 class DSDPCMConverterMultistage : public DSDPCMConverter<real_t> {
+protected:
+	int block_samples;
+public:
+	DSDPCMConverterMultistage() {
+		block_samples = 0;
+	}
+	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		if (block_samples <= 0) {
+			return convert_block(dsd_data, pcm_data, dsd_samples);
+		}
+		int pcm_samples = 0;
+		for (int offset = 0; offset < dsd_samples; offset += block_samples) {
+			int samples = (dsd_samples - offset < block_samples) ? dsd_samples - offset : block_samples;
+			pcm_samples += convert_block(dsd_data + offset, pcm_data + pcm_samples, samples);
+		}
+		return pcm_samples;
+	}
+protected:
+	int set_block_samples(int dsd_samples, int fir1_decimation) {
+		block_samples = DSDPCM_FUSED_SAMPLES * fir1_decimation / 8;
+		if (block_samples > dsd_samples) {
+			block_samples = dsd_samples;
+		}
+		return block_samples;
+	}
+	virtual int convert_block(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) = 0;
 };
 
 template<typename real_t>
@@ -35,24 +68,25 @@ class DSDPCMConverterMultistage_x512 : public DSDPCMConverterMultistage<real_t>
 	PCMPCMFir<real_t> pcm_fir3;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples / 2);
-		alloc_pcm_temp2(dsd_samples / 4);
+		int block_samples = this->set_block_samples(dsd_samples, 16);
+		this->alloc_pcm_temp1(block_samples / 2);
+		this->alloc_pcm_temp2(block_samples / 4);
 		dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
 		pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
 		pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
 		pcm_fir2c.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
 		pcm_fir2d.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-		delay = (((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+		this->delay = ((((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir2d.get_decimation() + pcm_fir2d.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 	}
-	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+	int convert_block(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
-		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-		pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-		pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
-		pcm_samples = pcm_fir2c.run(pcm_temp1, pcm_temp2, pcm_samples);
-		pcm_samples = pcm_fir2d.run(pcm_temp2, pcm_temp1, pcm_samples);
-		pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
+		pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+		pcm_samples = pcm_fir2b.run(this->pcm_temp2, this->pcm_temp1, pcm_samples);
+		pcm_samples = pcm_fir2c.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+		pcm_samples = pcm_fir2d.run(this->pcm_temp2, this->pcm_temp1, pcm_samples);
+		pcm_samples = pcm_fir3.run(this->pcm_temp1, pcm_data, pcm_samples);
 		return pcm_samples;
 	}
 };
@@ -66,22 +100,23 @@ class DSDPCMConverterMultistage_x256 : public DSDPCMConverterMultistage<real_t>
 	PCMPCMFir<real_t> pcm_fir3;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples / 2);
-		alloc_pcm_temp2(dsd_samples / 4);
+		int block_samples = this->set_block_samples(dsd_samples, 16);
+		this->alloc_pcm_temp1(block_samples / 2);
+		this->alloc_pcm_temp2(block_samples / 4);
 		dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
 		pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
 		pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
 		pcm_fir2c.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-		delay = (((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+		this->delay = (((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 	}
-	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+	int convert_block(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
-		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-		pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-		pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
-		pcm_samples = pcm_fir2c.run(pcm_temp1, pcm_temp2, pcm_samples);
-		pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
+		pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+		pcm_samples = pcm_fir2b.run(this->pcm_temp2, this->pcm_temp1, pcm_samples);
+		pcm_samples = pcm_fir2c.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+		pcm_samples = pcm_fir3.run(this->pcm_temp2, pcm_data, pcm_samples);
 		return pcm_samples;
 	}
 };
@@ -94,20 +129,21 @@ class DSDPCMConverterMultistage_x128 : public DSDPCMConverterMultistage<real_t>
 	PCMPCMFir<real_t> pcm_fir3;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples / 2);
-		alloc_pcm_temp2(dsd_samples / 4);
+		int block_samples = this->set_block_samples(dsd_samples, 16);
+		this->alloc_pcm_temp1(block_samples / 2);
+		this->alloc_pcm_temp2(block_samples / 4);
 		dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
 		pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
 		pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-		delay = ((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+		this->delay = ((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 	}
-	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+	int convert_block(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
-		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-		pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-		pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
-		pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
+		pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+		pcm_samples = pcm_fir2b.run(this->pcm_temp2, this->pcm_temp1, pcm_samples);
+		pcm_samples = pcm_fir3.run(this->pcm_temp1, pcm_data, pcm_samples);
 		return pcm_samples;
 	}
 };
@@ -119,18 +155,19 @@ class DSDPCMConverterMultistage_x64 : public DSDPCMConverterMultistage<real_t> {
 	PCMPCMFir<real_t> pcm_fir3;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples / 2);
-		alloc_pcm_temp2(dsd_samples / 4);
+		int block_samples = this->set_block_samples(dsd_samples, 16);
+		this->alloc_pcm_temp1(block_samples / 2);
+		this->alloc_pcm_temp2(block_samples / 4);
 		dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
 		pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-		delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+		this->delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 	}
-	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+	int convert_block(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
-		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-		pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-		pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
+		pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+		pcm_samples = pcm_fir3.run(this->pcm_temp2, pcm_data, pcm_samples);
 		return pcm_samples;
 	}
 };
@@ -142,18 +179,19 @@ class DSDPCMConverterMultistage_x32 : public DSDPCMConverterMultistage<real_t> {
 	PCMPCMFir<real_t> pcm_fir3;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples);
-		alloc_pcm_temp2(dsd_samples / 2);
+		int block_samples = this->set_block_samples(dsd_samples, 8);
+		this->alloc_pcm_temp1(block_samples);
+		this->alloc_pcm_temp2(block_samples / 2);
 		dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
 		pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-		delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+		this->delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 	}
-	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+	int convert_block(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
-		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-		pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-		pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
+		pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+		pcm_samples = pcm_fir3.run(this->pcm_temp2, pcm_data, pcm_samples);
 		return pcm_samples;
 	}
 };
@@ -164,15 +202,16 @@ class DSDPCMConverterMultistage_x16 : public DSDPCMConverterMultistage<real_t> {
 	PCMPCMFir<real_t> pcm_fir3;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
-		alloc_pcm_temp1(dsd_samples);
+		int block_samples = this->set_block_samples(dsd_samples, 8);
+		this->alloc_pcm_temp1(block_samples);
 		dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
-		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-		delay = dsd_fir1.get_delay() / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+		pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_pcm_sum_fp64());
+		this->delay = dsd_fir1.get_delay() / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 	}
-	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+	int convert_block(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
-		pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-		pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
+		pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = pcm_fir3.run(this->pcm_temp1, pcm_data, pcm_samples);
 		return pcm_samples;
 	}
 };
@@ -183,9 +222,9 @@ class DSDPCMConverterMultistage_x8 : public DSDPCMConverterMultistage<real_t> {
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
 		dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
-		delay = dsd_fir1.get_delay();
+		this->delay = dsd_fir1.get_delay();
 	}
-	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+	int convert_block(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples;
 		pcm_samples = dsd_fir1.run(dsd_data, pcm_data, dsd_samples);
 		return pcm_samples;
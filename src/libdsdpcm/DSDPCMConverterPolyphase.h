@@ -0,0 +1,59 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "DSDPCMConverter.h"
+#include "PCMPCMResampler.h"
+
+/*
+* Runs a 44.1 kHz-family cascade and resamples its output by L/M
+* (e.g. 160/147 for 48/96/192 kHz) in the same pass.
+*/
+
+template<typename real_t>
+class DSDPCMConverterPolyphase : public DSDPCMConverter<real_t> {
+	DSDPCMConverter<real_t>* converter;
+	int decimation;
+	int interpolation;
+	int resampler_decimation;
+	PCMPCMResampler<real_t> resampler;
+public:
+	DSDPCMConverterPolyphase(DSDPCMConverter<real_t>* converter, int decimation, int interpolation, int resampler_decimation) {
+		this->converter = converter;
+		this->decimation = decimation;
+		this->interpolation = interpolation;
+		this->resampler_decimation = resampler_decimation;
+	}
+	~DSDPCMConverterPolyphase() {
+		delete converter;
+	}
+	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
+		converter->init(flt_setup, dsd_samples);
+		resampler.init(interpolation, resampler_decimation, PCMxFs48_TAPS, 1, flt_setup.get_pcm_sum_fp64());
+		this->alloc_pcm_temp1(dsd_samples * 8 / decimation);
+		this->delay = converter->get_delay() * resampler.get_interpolation() / resampler.get_decimation() + resampler.get_delay();
+	}
+	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		int pcm_samples;
+		pcm_samples = converter->convert(dsd_data, this->pcm_temp1, dsd_samples);
+		pcm_samples = resampler.run(this->pcm_temp1, pcm_data, pcm_samples);
+		return pcm_samples;
+	}
+};
@@ -0,0 +1,114 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <math.h>
+#include <complex>
+
+#include "DSDPCMUtil.h"
+
+/*
+* In-place radix-2 complex FFT with precomputed twiddles and bit reversal.
+* The inverse transform is scaled by 1/N.
+*/
+
+template<typename real_t>
+class DSDPCMFFT {
+	using complex_t = std::complex<real_t>;
+	int        fft_size;
+	complex_t* twiddles;
+	int*       bit_reverse;
+public:
+	DSDPCMFFT() {
+		fft_size = 0;
+		twiddles = nullptr;
+		bit_reverse = nullptr;
+	}
+	~DSDPCMFFT() {
+		free();
+	}
+	void init(int fft_size) {
+		const double pi = 3.14159265358979323846;
+		free();
+		this->fft_size = fft_size;
+		twiddles = (complex_t*)DSDPCMUtil::mem_alloc(fft_size / 2 * sizeof(complex_t));
+		for (int k = 0; k < fft_size / 2; k++) {
+			twiddles[k] = complex_t((real_t)cos(-2.0 * pi * k / fft_size), (real_t)sin(-2.0 * pi * k / fft_size));
+		}
+		bit_reverse = (int*)DSDPCMUtil::mem_alloc(fft_size * sizeof(int));
+		int bits = 0;
+		while ((1 << bits) < fft_size) {
+			bits++;
+		}
+		for (int i = 0; i < fft_size; i++) {
+			int r = 0;
+			for (int b = 0; b < bits; b++) {
+				r |= ((i >> b) & 1) << (bits - 1 - b);
+			}
+			bit_reverse[i] = r;
+		}
+	}
+	void free() {
+		DSDPCMUtil::mem_free(twiddles);
+		twiddles = nullptr;
+		DSDPCMUtil::mem_free(bit_reverse);
+		bit_reverse = nullptr;
+		fft_size = 0;
+	}
+	int get_size() {
+		return fft_size;
+	}
+	void forward(complex_t* data) {
+		transform(data, false);
+	}
+	void inverse(complex_t* data) {
+		transform(data, true);
+		real_t scale = (real_t)1 / (real_t)fft_size;
+		for (int i = 0; i < fft_size; i++) {
+			data[i] *= scale;
+		}
+	}
+private:
+	void transform(complex_t* data, bool inverse) {
+		for (int i = 0; i < fft_size; i++) {
+			if (i < bit_reverse[i]) {
+				complex_t temp = data[i];
+				data[i] = data[bit_reverse[i]];
+				data[bit_reverse[i]] = temp;
+			}
+		}
+		real_t sign = inverse ? (real_t)-1 : (real_t)1;
+		for (int len = 2; len <= fft_size; len <<= 1) {
+			int half = len / 2;
+			int step = fft_size / len;
+			for (int i = 0; i < fft_size; i += len) {
+				for (int j = 0; j < half; j++) {
+					real_t w_re = twiddles[j * step].real();
+					real_t w_im = sign * twiddles[j * step].imag();
+					complex_t u = data[i + j];
+					complex_t x = data[i + j + half];
+					complex_t v(x.real() * w_re - x.imag() * w_im, x.real() * w_im + x.imag() * w_re);
+					data[i + j] = u + v;
+					data[i + j + half] = u - v;
+				}
+			}
+		}
+	}
+};
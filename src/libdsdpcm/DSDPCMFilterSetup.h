@@ -21,44 +21,75 @@
 
 #include "DSDPCMConstants.h"
 #include "DSDPCMUtil.h"
+#include "DSDPCMCTables.h"
+#include "DSDPCMFFT.h"
 
 template<typename real_t>
 class DSDPCMFilterSetup	{
-	using ctable_t = real_t[256];
+	using ctable_t = DSDPCMCTables;
 	ctable_t* dsd_fir1_8_ctables;
 	ctable_t* dsd_fir1_16_ctables;
 	ctable_t* dsd_fir1_64_ctables;
+	int       ctables_radix;
+	bool      ctables_fp32;
+	bool      ctables_symmetric;
+	int       ctables_planes;
+	bool      pcm_sum_fp64;
+	bool      min_phase;
+	double*   dsd_fir1_8_mp_coefs;
+	double*   dsd_fir1_16_mp_coefs;
+	double*   pcm_fir2_2_mp_coefs;
+	double*   pcm_fir3_2_mp_coefs;
 	real_t*   pcm_fir2_2_coefs;
 	real_t*   pcm_fir3_2_coefs;
 	double*   dsd_fir1_64_coefs;
 	int       dsd_fir1_64_length;
 	bool      dsd_fir1_64_modified;
-	float     dsd_fir1_dB_gain;
-	double    dsd_fir1_gain;
 public:
 	DSDPCMFilterSetup() {
 		dsd_fir1_8_ctables = nullptr;
 		dsd_fir1_16_ctables = nullptr;
 		dsd_fir1_64_ctables = nullptr;
+		ctables_radix = DSDPCM_RADIX_DEFAULT;
+		ctables_fp32 = !DSDPCMSample<real_t>::fixed && sizeof(real_t) == sizeof(float);
+		ctables_symmetric = false;
+		ctables_planes = 0;
+		pcm_sum_fp64 = false;
+		min_phase = false;
+		dsd_fir1_8_mp_coefs = nullptr;
+		dsd_fir1_16_mp_coefs = nullptr;
+		pcm_fir2_2_mp_coefs = nullptr;
+		pcm_fir3_2_mp_coefs = nullptr;
 		pcm_fir2_2_coefs = nullptr;
 		pcm_fir3_2_coefs = nullptr;
 		dsd_fir1_64_coefs = nullptr;
 		dsd_fir1_64_length = 0;
 		dsd_fir1_64_modified = false;
-		dsd_fir1_dB_gain = 0;
-		dsd_fir1_gain = 1;
 	}
 	~DSDPCMFilterSetup() {
+		flush();
+	}
+	void flush() {
 		flush_fir1_ctables();
 		DSDPCMUtil::mem_free(pcm_fir2_2_coefs);
+		pcm_fir2_2_coefs = nullptr;
 		DSDPCMUtil::mem_free(pcm_fir3_2_coefs);
+		pcm_fir3_2_coefs = nullptr;
+		DSDPCMUtil::mem_free(dsd_fir1_8_mp_coefs);
+		dsd_fir1_8_mp_coefs = nullptr;
+		DSDPCMUtil::mem_free(dsd_fir1_16_mp_coefs);
+		dsd_fir1_16_mp_coefs = nullptr;
+		DSDPCMUtil::mem_free(pcm_fir2_2_mp_coefs);
+		pcm_fir2_2_mp_coefs = nullptr;
+		DSDPCMUtil::mem_free(pcm_fir3_2_mp_coefs);
+		pcm_fir3_2_mp_coefs = nullptr;
 	}
 	void flush_fir1_ctables() {
-		DSDPCMUtil::mem_free(dsd_fir1_8_ctables);
+		DSDPCMCTablesCache::instance().release(dsd_fir1_8_ctables);
 		dsd_fir1_8_ctables = nullptr;
-		DSDPCMUtil::mem_free(dsd_fir1_16_ctables);
+		DSDPCMCTablesCache::instance().release(dsd_fir1_16_ctables);
 		dsd_fir1_16_ctables = nullptr;
-		DSDPCMUtil::mem_free(dsd_fir1_64_ctables);
+		DSDPCMCTablesCache::instance().release(dsd_fir1_64_ctables);
 		dsd_fir1_64_ctables = nullptr;
 	}
 	static const double NORM_I(const int scale = 0) {
@@ -66,8 +97,7 @@ public:
 	}
 	ctable_t* get_fir1_8_ctables() {
 		if (!dsd_fir1_8_ctables) {
-			dsd_fir1_8_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(DSDFIR1_8_LENGTH) * sizeof(ctable_t));
-			set_ctables(DSDFIR1_8_COEFS, DSDFIR1_8_LENGTH, NORM_I(3) * dsd_fir1_gain , dsd_fir1_8_ctables);
+			dsd_fir1_8_ctables = make_ctables(get_coefs(DSDFIR1_8_COEFS, DSDFIR1_8_LENGTH, dsd_fir1_8_mp_coefs), DSDFIR1_8_LENGTH, NORM_I(3));
 		}
 		return dsd_fir1_8_ctables;
 	}
@@ -76,8 +106,7 @@ public:
 	}
 	ctable_t* get_fir1_16_ctables() {
 		if (!dsd_fir1_16_ctables) {
-			dsd_fir1_16_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(DSDFIR1_16_LENGTH) * sizeof(ctable_t));
-			set_ctables(DSDFIR1_16_COEFS, DSDFIR1_16_LENGTH, NORM_I(3) * dsd_fir1_gain, dsd_fir1_16_ctables);
+			dsd_fir1_16_ctables = make_ctables(get_coefs(DSDFIR1_16_COEFS, DSDFIR1_16_LENGTH, dsd_fir1_16_mp_coefs), DSDFIR1_16_LENGTH, NORM_I(3));
 		}
 		return dsd_fir1_16_ctables;
 	}
@@ -86,24 +115,28 @@ public:
 	}
 	ctable_t* get_fir1_64_ctables() {
 		if (dsd_fir1_64_modified && dsd_fir1_64_coefs && dsd_fir1_64_length > 0) {
-			DSDPCMUtil::mem_free(dsd_fir1_64_ctables);
-			dsd_fir1_64_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(dsd_fir1_64_length) * sizeof(ctable_t));
-			set_ctables(dsd_fir1_64_coefs, dsd_fir1_64_length, dsd_fir1_gain, dsd_fir1_64_ctables);
+			DSDPCMCTablesCache::instance().release(dsd_fir1_64_ctables);
+			dsd_fir1_64_ctables = make_ctables(dsd_fir1_64_coefs, dsd_fir1_64_length, 1.0);
 			dsd_fir1_64_modified = false;
 		}
 		if (!dsd_fir1_64_ctables) {
-			dsd_fir1_64_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(DSDFIR1_64_LENGTH) * sizeof(ctable_t));
-			set_ctables(DSDFIR1_64_COEFS, DSDFIR1_64_LENGTH, NORM_I() * dsd_fir1_gain, dsd_fir1_64_ctables);
+			dsd_fir1_64_ctables = make_ctables(DSDFIR1_64_COEFS, DSDFIR1_64_LENGTH, NORM_I());
 		}
 		return dsd_fir1_64_ctables;
 	}
 	int get_fir1_64_length() {
 		return (dsd_fir1_64_coefs && dsd_fir1_64_length > 0) ? dsd_fir1_64_length : DSDFIR1_64_LENGTH;
 	}
+	const double* get_fir1_64_coefs() {
+		return (dsd_fir1_64_coefs && dsd_fir1_64_length > 0) ? dsd_fir1_64_coefs : DSDFIR1_64_COEFS;
+	}
+	double get_fir1_64_gain() {
+		return (dsd_fir1_64_coefs && dsd_fir1_64_length > 0) ? 1.0 : NORM_I();
+	}
 	real_t* get_fir2_2_coefs() {
 		if (!pcm_fir2_2_coefs) {
 			pcm_fir2_2_coefs = (real_t*)DSDPCMUtil::mem_alloc(PCMFIR2_2_LENGTH * sizeof(real_t));
-			set_coefs(PCMFIR2_2_COEFS, PCMFIR2_2_LENGTH, NORM_I(), pcm_fir2_2_coefs);
+			set_coefs(get_coefs(PCMFIR2_2_COEFS, PCMFIR2_2_LENGTH, pcm_fir2_2_mp_coefs), PCMFIR2_2_LENGTH, NORM_I(), pcm_fir2_2_coefs);
 		}
 		return pcm_fir2_2_coefs;
 	}
@@ -113,49 +146,145 @@ public:
 	real_t* get_fir3_2_coefs() {
 		if (!pcm_fir3_2_coefs) {
 			pcm_fir3_2_coefs = (real_t*)DSDPCMUtil::mem_alloc(PCMFIR3_2_LENGTH * sizeof(real_t));
-			set_coefs(PCMFIR3_2_COEFS, PCMFIR3_2_LENGTH, NORM_I(), pcm_fir3_2_coefs);
+			set_coefs(get_coefs(PCMFIR3_2_COEFS, PCMFIR3_2_LENGTH, pcm_fir3_2_mp_coefs), PCMFIR3_2_LENGTH, NORM_I(), pcm_fir3_2_coefs);
 		}
 		return pcm_fir3_2_coefs;
 	}
 	int get_fir3_2_length() {
 		return PCMFIR3_2_LENGTH;
 	}
+	size_t get_ctables_bytes() {
+		size_t bytes = 0;
+		bytes += dsd_fir1_8_ctables ? dsd_fir1_8_ctables->get_bytes() : 0;
+		bytes += dsd_fir1_16_ctables ? dsd_fir1_16_ctables->get_bytes() : 0;
+		bytes += dsd_fir1_64_ctables ? dsd_fir1_64_ctables->get_bytes() : 0;
+		return bytes;
+	}
 	void set_fir1_64_coefs(double* fir_coefs, int fir_length) {
 		dsd_fir1_64_modified = dsd_fir1_64_coefs || fir_coefs;
 		dsd_fir1_64_coefs = fir_coefs;
 		dsd_fir1_64_length = fir_length;
 	}
-	void set_gain(float dB_gain) {
-		if (dB_gain != dsd_fir1_dB_gain) {
+	void set_ctables_layout(int radix, bool fp32, bool symmetric) {
+		if (radix < 1 || radix > DSDPCM_RADIX_MAX) {
+			radix = DSDPCM_RADIX_DEFAULT;
+		}
+		fp32 = !DSDPCMSample<real_t>::fixed && (fp32 || sizeof(real_t) == sizeof(float));
+#ifdef _USE_IPP
+		// the IPP kernel reads plain radix 8 tables of real_t
+		if (!DSDPCMSample<real_t>::fixed) {
+			radix = DSDPCM_RADIX_DEFAULT;
+			fp32 = sizeof(real_t) == sizeof(float);
+			symmetric = false;
+		}
+#endif
+		if (radix != ctables_radix || fp32 != ctables_fp32 || symmetric != ctables_symmetric) {
 			flush_fir1_ctables();
-			dsd_fir1_dB_gain = dB_gain;
-			dsd_fir1_gain = pow(10.0, dsd_fir1_dB_gain / 20.0);
+			ctables_radix = radix;
+			ctables_fp32 = fp32;
+			ctables_symmetric = symmetric;
+		}
+	}
+	/*
+	* Bit-plane first stage: coefficients quantized to planes bits (2 to 32)
+	* and summed by popcount in place of table lookups, 0 for tables.
+	*/
+	void set_ctables_planes(int planes) {
+		planes = (planes > 0) ? ((planes < 2) ? 2 : (planes > 32) ? 32 : planes) : 0;
+#ifdef _USE_IPP
+		// the IPP kernel has no bit-plane path
+		if (!DSDPCMSample<real_t>::fixed) {
+			planes = 0;
+		}
+#endif
+		if (planes != ctables_planes) {
+			flush_fir1_ctables();
+			ctables_planes = planes;
+		}
+	}
+	/*
+	* Mixed precision: a single precision cascade sums its last PCM stage
+	* (PCMFIR3_2 or the polyphase resampler) in double.
+	*/
+	void set_pcm_sum_fp64(bool sum_fp64) {
+		pcm_sum_fp64 = sum_fp64 && !DSDPCMSample<real_t>::fixed && sizeof(real_t) == sizeof(float);
+	}
+	bool get_pcm_sum_fp64() {
+		return pcm_sum_fp64;
+	}
+	void set_min_phase(bool min_phase) {
+		if (min_phase != this->min_phase) {
+			flush_fir1_ctables();
+			DSDPCMUtil::mem_free(pcm_fir2_2_coefs);
+			pcm_fir2_2_coefs = nullptr;
+			DSDPCMUtil::mem_free(pcm_fir3_2_coefs);
+			pcm_fir3_2_coefs = nullptr;
+			this->min_phase = min_phase;
 		}
 	}
 private:
-	int set_ctables(const double* fir_coefs, const int fir_length, const double fir_gain, ctable_t* out_ctables) {
-		int ctables = CTABLES(fir_length);
-		for (int ct = 0; ct < ctables; ct++) {
-			int k = fir_length - ct * 8;
-			if (k > 8) {
-				k = 8;
+	const double* get_coefs(const double* fir_coefs, const int fir_length, double*& mp_coefs) {
+		if (!min_phase) {
+			return fir_coefs;
+		}
+		if (!mp_coefs) {
+			mp_coefs = (double*)DSDPCMUtil::mem_alloc(fir_length * sizeof(double));
+			make_min_phase(fir_coefs, fir_length, mp_coefs);
+		}
+		return mp_coefs;
+	}
+	static void make_min_phase(const double* fir_coefs, const int fir_length, double* mp_coefs) {
+		// Homomorphic (real cepstrum) design: same magnitude response, energy packed at the front
+		int fft_size = 4096;
+		while (fft_size < 32 * fir_length) {
+			fft_size *= 2;
+		}
+		DSDPCMFFT<double> fft;
+		fft.init(fft_size);
+		std::complex<double>* spectrum = new std::complex<double>[fft_size];
+		for (int i = 0; i < fft_size; i++) {
+			spectrum[i] = (i < fir_length) ? fir_coefs[i] : 0.0;
+		}
+		fft.forward(spectrum);
+		double peak = 0.0;
+		for (int i = 0; i < fft_size; i++) {
+			if (std::abs(spectrum[i]) > peak) {
+				peak = std::abs(spectrum[i]);
 			}
-			if (k < 0) {
-				k = 0;
+		}
+		for (int i = 0; i < fft_size; i++) {
+			double magnitude = std::abs(spectrum[i]);
+			spectrum[i] = log((magnitude > peak * 1e-10) ? magnitude : peak * 1e-10);
+		}
+		fft.inverse(spectrum);
+		for (int i = 1; i < fft_size; i++) {
+			if (i < fft_size / 2) {
+				spectrum[i] = 2.0 * spectrum[i].real();
 			}
-			for (int i = 0; i < 256; i++) {
-				double cvalue = 0.0;
-				for (int j = 0; j < k; j++) {
-					cvalue += (((i >> (7 - j)) & 1) * 2 - 1) * fir_coefs[fir_length - 1 - (ct * 8 + j)];
-				}
-				out_ctables[ct][i] = (real_t)(cvalue * fir_gain);
+			else if (i > fft_size / 2) {
+				spectrum[i] = 0.0;
 			}
+			else {
+				spectrum[i] = spectrum[i].real();
+			}
+		}
+		spectrum[0] = spectrum[0].real();
+		fft.forward(spectrum);
+		for (int i = 0; i < fft_size; i++) {
+			spectrum[i] = std::exp(spectrum[i]);
 		}
-		return ctables;
+		fft.inverse(spectrum);
+		for (int i = 0; i < fir_length; i++) {
+			mp_coefs[i] = spectrum[i].real();
+		}
+		delete[] spectrum;
+	}
+	ctable_t* make_ctables(const double* fir_coefs, const int fir_length, const double fir_gain) {
+		return DSDPCMCTablesCache::instance().acquire(fir_coefs, fir_length, fir_gain, ctables_radix, ctables_symmetric, ctables_fp32, sizeof(real_t), DSDPCMSample<real_t>::fixed, ctables_planes);
 	}
 	void set_coefs(const double* fir_coefs, const int fir_length, const double fir_gain, real_t* out_coefs) {
 		for (int i = 0; i < fir_length; i++) {
-			out_coefs[i] = (real_t)(fir_coefs[fir_length - 1 - i] * fir_gain);
+			out_coefs[i] = DSDPCMSample<real_t>::make_coef(fir_coefs[fir_length - 1 - i] * fir_gain);
 		}
 	}
 };
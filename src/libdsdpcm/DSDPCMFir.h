@@ -21,16 +21,19 @@
 
 #include "DSDPCMConstants.h"
 #include "DSDPCMUtil.h"
+#include "DSDPCMFilterSetup.h"
 
 template<typename real_t>
 class DSDPCMFir {
-	using ctable_t = real_t[256];
+	using ctable_t = DSDPCMCTables;
+	using accum_t = typename DSDPCMSample<real_t>::accum_t;
 	ctable_t* fir_ctables;
 	int       fir_order;
 	int       fir_length;
 	int       decimation;
 	uint8_t*  fir_buffer;
 	int       fir_index;
+	uint64_t* fir_words;
 public:
 	DSDPCMFir() {
 		fir_ctables = nullptr;
@@ -39,6 +42,7 @@ public:
 		decimation = 0;
 		fir_buffer = nullptr;
 		fir_index = 0;
+		fir_words = nullptr;
 	}
 	~DSDPCMFir() {
 		free();
@@ -48,9 +52,12 @@ public:
 		this->fir_order = fir_length - 1;
 		this->fir_length = CTABLES(fir_length);
 		this->decimation = decimation / 8;
-		int buf_size = 2 * this->fir_length * sizeof(uint8_t);
+		int buf_size = (2 * this->fir_length + CTABLES_PAD) * sizeof(uint8_t);
 		this->fir_buffer = (uint8_t*)DSDPCMUtil::mem_alloc(buf_size);
 		memset(this->fir_buffer, DSD_SILENCE_BYTE, buf_size);
+		if (fir_ctables->planes > 0) {
+			this->fir_words = (uint64_t*)DSDPCMUtil::mem_alloc(fir_ctables->words * sizeof(uint64_t));
+		}
 		fir_index = 0;
 	}
 	void free() {
@@ -58,24 +65,89 @@ public:
 			DSDPCMUtil::mem_free(fir_buffer);
 			fir_buffer = nullptr;
 		}
+		DSDPCMUtil::mem_free(fir_words);
+		fir_words = nullptr;
 	}
 	int get_decimation() {
 		return decimation;
 	}
 	float get_delay() {
-		return (float)fir_order / 2 / 8 / decimation;
+		return (fir_ctables->fir_delay + 8 * fir_length - fir_order) / 8 / decimation - 1;
+	}
+	int run(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		if (fir_ctables->planes > 0) {
+			return run_planes(dsd_data, pcm_data, dsd_samples);
+		}
+		if (fir_ctables->fp32) {
+			return run<float>(dsd_data, pcm_data, dsd_samples);
+		}
+		return run<real_t>(dsd_data, pcm_data, dsd_samples);
+	}
+private:
+	int run_planes(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		int pcm_samples = dsd_samples / decimation;
+		for (int sample = 0; sample < pcm_samples; sample++) {
+			for (int i = 0; i < decimation; i++) {
+				fir_buffer[fir_index + fir_length] = fir_buffer[fir_index] = *(dsd_data++);
+				fir_index = (fir_index + 1) % fir_length;
+			}
+			memcpy(fir_words, fir_buffer + fir_index, fir_length);
+			pcm_data[sample] = DSDPCMSample<real_t>::make_value(fir_ctables->get_plane_value(fir_words));
+		}
+		return pcm_samples;
 	}
+	template<typename table_t>
 	int run(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
 		int pcm_samples = dsd_samples / decimation;
+		int radix = fir_ctables->radix;
+		int ctables = fir_ctables->count;
 		for (int sample = 0; sample < pcm_samples; sample++) {
 			for (int i = 0; i < decimation; i++) {
 				fir_buffer[fir_index + fir_length] = fir_buffer[fir_index] = *(dsd_data++);
 				fir_index = (++fir_index) % fir_length;
 			}
-			pcm_data[sample] = (real_t)0;
-			for (int j = 0; j < fir_length; j++) {
-				pcm_data[sample] += fir_ctables[j][fir_buffer[fir_index + j]];
+			const uint8_t* fir_window = fir_buffer + fir_index;
+			accum_t pcm_sample = 0;
+			if (fir_ctables->mirrors > 0) {
+				int mirrors = fir_ctables->mirrors;
+				for (int j = 0; j < mirrors; j++) {
+					const table_t* ctable = fir_ctables->get<table_t>(j);
+					int index = (radix == 8) ? fir_window[j] : ctable_t::get_index(fir_window, 1, j * radix, radix);
+					pcm_sample += ctable[index] + ctable[fir_ctables->get_mirror_index(fir_window, 1, j)];
+				}
+				for (int j = mirrors; j < ctables; j++) {
+					pcm_sample += fir_ctables->get<table_t>(j)[ctable_t::get_index(fir_window, 1, j * radix, radix)];
+				}
+				pcm_data[sample] = DSDPCMSample<real_t>::from_sum(pcm_sample);
+				continue;
+			}
+			switch (radix) {
+			case 8:
+				for (int j = 0; j < ctables; j++) {
+					pcm_sample += fir_ctables->get<table_t>(j)[fir_window[j]];
+				}
+				break;
+			case 4:
+				for (int j = 0; j < ctables / 2; j++) {
+					pcm_sample += fir_ctables->get<table_t>(2 * j + 0)[fir_window[j] >> 4];
+					pcm_sample += fir_ctables->get<table_t>(2 * j + 1)[fir_window[j] & 0x0f];
+				}
+				if (ctables & 1) {
+					pcm_sample += fir_ctables->get<table_t>(ctables - 1)[fir_window[ctables / 2] >> 4];
+				}
+				break;
+			case 16:
+				for (int j = 0; j < ctables; j++) {
+					pcm_sample += fir_ctables->get<table_t>(j)[((int)fir_window[2 * j] << 8) | fir_window[2 * j + 1]];
+				}
+				break;
+			default:
+				for (int j = 0; j < ctables; j++) {
+					pcm_sample += fir_ctables->get<table_t>(j)[ctable_t::get_index(fir_window, 1, j * radix, radix)];
+				}
+				break;
 			}
+			pcm_data[sample] = DSDPCMSample<real_t>::from_sum(pcm_sample);
 		}
 		return pcm_samples;
 	}
@@ -0,0 +1,115 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "DSDPCMConstants.h"
+#include "DSDPCMUtil.h"
+#include "PCMPCMFirFFT.h"
+
+/*
+* DSD FIR on top of the partitioned FFT convolution, for long (user) filters
+* where the lookup-table DSDPCMFir cost (one lookup per 8 taps) dominates.
+* Coefficients are aligned like the lookup tables, so both give the same
+* response and delay apart from the FFT block latency.
+*/
+
+template<typename real_t>
+class DSDPCMFirFFT {
+	PCMPCMFirFFT<real_t> pcm_fir;
+	int     fir_length;
+	int     decimation;
+	real_t* bit_values;
+	real_t* bit_buffer;
+	int     bit_buffer_bytes;
+public:
+	DSDPCMFirFFT() {
+		fir_length = 0;
+		decimation = 0;
+		bit_values = nullptr;
+		bit_buffer = nullptr;
+		bit_buffer_bytes = 0;
+	}
+	~DSDPCMFirFFT() {
+		free();
+	}
+	void init(const double* fir_coefs, int fir_length, double fir_gain, int decimation) {
+		free();
+		this->fir_length = fir_length;
+		this->decimation = decimation / 8;
+		int fir_pad = 8 * CTABLES(fir_length) - fir_length;
+		double* fir_aligned = new double[fir_length + fir_pad];
+		for (int i = 0; i < fir_length + fir_pad; i++) {
+			fir_aligned[i] = (i < fir_pad) ? 0.0 : fir_coefs[i - fir_pad];
+		}
+		pcm_fir.init(fir_aligned, fir_length + fir_pad, fir_gain, decimation, PCMPCMFirFFT<real_t>::select_block_size(fir_length + fir_pad, decimation));
+		delete[] fir_aligned;
+		bit_values = (real_t*)DSDPCMUtil::mem_alloc(256 * 8 * sizeof(real_t));
+		for (int i = 0; i < 256; i++) {
+			for (int j = 0; j < 8; j++) {
+				bit_values[i * 8 + j] = (real_t)((((i >> (7 - j)) & 1) * 2) - 1);
+			}
+		}
+		bit_buffer_bytes = this->decimation * 64;
+		bit_buffer = (real_t*)DSDPCMUtil::mem_alloc(bit_buffer_bytes * 8 * sizeof(real_t));
+		// Fill the history with DSD silence, as the table driven kernels do, and keep the block latency silent
+		int block_size = pcm_fir.get_block_size();
+		int prime_samples = ((CTABLES(fir_length) + this->decimation - 1) / this->decimation + block_size - 1) / block_size * block_size;
+		uint8_t* prime_data = (uint8_t*)DSDPCMUtil::mem_alloc(prime_samples * this->decimation);
+		real_t* prime_pcm = (real_t*)DSDPCMUtil::mem_alloc(prime_samples * sizeof(real_t));
+		memset(prime_data, DSD_SILENCE_BYTE, prime_samples * this->decimation);
+		run(prime_data, prime_pcm, prime_samples * this->decimation);
+		pcm_fir.clear_output();
+		DSDPCMUtil::mem_free(prime_pcm);
+		DSDPCMUtil::mem_free(prime_data);
+	}
+	void free() {
+		pcm_fir.free();
+		DSDPCMUtil::mem_free(bit_values);
+		bit_values = nullptr;
+		DSDPCMUtil::mem_free(bit_buffer);
+		bit_buffer = nullptr;
+	}
+	int get_decimation() {
+		return decimation;
+	}
+	float get_delay() {
+		return pcm_fir.get_delay();
+	}
+	int run(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		int pcm_samples = 0;
+		dsd_samples -= dsd_samples % decimation;
+		while (dsd_samples > 0) {
+			int chunk_bytes = (dsd_samples < bit_buffer_bytes) ? dsd_samples : bit_buffer_bytes;
+			for (int i = 0; i < chunk_bytes; i++) {
+				memcpy(bit_buffer + i * 8, bit_values + dsd_data[i] * 8, 8 * sizeof(real_t));
+			}
+			pcm_samples += pcm_fir.run(bit_buffer, pcm_data + pcm_samples, chunk_bytes * 8);
+			dsd_data += chunk_bytes;
+			dsd_samples -= chunk_bytes;
+		}
+		return pcm_samples;
+	}
+	static bool is_cheaper(int fir_length, int decimation) {
+		int fir_aligned = 8 * CTABLES(fir_length);
+		int block_size = PCMPCMFirFFT<real_t>::select_block_size(fir_aligned, decimation);
+		// A table lookup is a cache miss more often than not, weigh it as 4 flops
+		return PCMPCMFirFFT<real_t>::get_cost(fir_aligned, decimation, block_size) < 4.0 * CTABLES(fir_length);
+	}
+};
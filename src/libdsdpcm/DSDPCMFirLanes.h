@@ -0,0 +1,181 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "DSDPCMConstants.h"
+#include "DSDPCMUtil.h"
+#include "DSDPCMFilterSetup.h"
+
+/*
+* DSD FIR running all channels of an interleaved stream at once.
+* The history buffer keeps channels interleaved, so the innermost loop walks
+* the channels with a shared ctable (one gather per ctable for all lanes).
+*/
+
+template<typename real_t>
+class DSDPCMFirLanes {
+	using ctable_t = DSDPCMCTables;
+	using accum_t = typename DSDPCMSample<real_t>::accum_t;
+	ctable_t* fir_ctables;
+	int       fir_order;
+	int       fir_length;
+	int       decimation;
+	int       channels;
+	uint8_t*  fir_buffer;
+	int       fir_index;
+	accum_t*  fir_accum;
+	uint64_t* fir_words;
+public:
+	DSDPCMFirLanes() {
+		fir_ctables = nullptr;
+		fir_order = 0;
+		fir_length = 0;
+		decimation = 0;
+		channels = 0;
+		fir_buffer = nullptr;
+		fir_index = 0;
+		fir_accum = nullptr;
+		fir_words = nullptr;
+	}
+	~DSDPCMFirLanes() {
+		free();
+	}
+	void init(ctable_t* fir_ctables, int fir_length, int decimation, int channels) {
+		this->fir_ctables = fir_ctables;
+		this->fir_order = fir_length - 1;
+		this->fir_length = CTABLES(fir_length);
+		this->decimation = decimation / 8;
+		this->channels = channels;
+		int buf_size = (2 * this->fir_length + CTABLES_PAD) * channels * sizeof(uint8_t);
+		this->fir_buffer = (uint8_t*)DSDPCMUtil::mem_alloc(buf_size);
+		memset(this->fir_buffer, DSD_SILENCE_BYTE, buf_size);
+		this->fir_accum = (accum_t*)DSDPCMUtil::mem_alloc(channels * sizeof(accum_t));
+		if (fir_ctables->planes > 0) {
+			this->fir_words = (uint64_t*)DSDPCMUtil::mem_alloc(fir_ctables->words * sizeof(uint64_t));
+		}
+		fir_index = 0;
+	}
+	void free() {
+		if (fir_buffer) {
+			DSDPCMUtil::mem_free(fir_buffer);
+			fir_buffer = nullptr;
+		}
+		DSDPCMUtil::mem_free(fir_accum);
+		fir_accum = nullptr;
+		DSDPCMUtil::mem_free(fir_words);
+		fir_words = nullptr;
+	}
+	int get_decimation() {
+		return decimation;
+	}
+	float get_delay() {
+		return (fir_ctables->fir_delay + 8 * fir_length - fir_order) / 8 / decimation - 1;
+	}
+	int run(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		if (fir_ctables->planes > 0) {
+			return run_planes(dsd_data, pcm_data, dsd_samples);
+		}
+		if (fir_ctables->fp32) {
+			return run<float>(dsd_data, pcm_data, dsd_samples);
+		}
+		return run<real_t>(dsd_data, pcm_data, dsd_samples);
+	}
+private:
+	int run_planes(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		int pcm_samples = dsd_samples / decimation;
+		for (int sample = 0; sample < pcm_samples; sample++) {
+			for (int i = 0; i < decimation; i++) {
+				uint8_t* buf_lo = fir_buffer + fir_index * channels;
+				uint8_t* buf_hi = fir_buffer + (fir_index + fir_length) * channels;
+				for (int ch = 0; ch < channels; ch++) {
+					buf_hi[ch] = buf_lo[ch] = dsd_data[ch];
+				}
+				dsd_data += channels;
+				fir_index = (fir_index + 1) % fir_length;
+			}
+			const uint8_t* fir_window = fir_buffer + fir_index * channels;
+			for (int ch = 0; ch < channels; ch++) {
+				uint8_t* window = (uint8_t*)fir_words;
+				for (int j = 0; j < fir_length; j++) {
+					window[j] = fir_window[j * channels + ch];
+				}
+				pcm_data[sample * channels + ch] = DSDPCMSample<real_t>::make_value(fir_ctables->get_plane_value(fir_words));
+			}
+		}
+		return pcm_samples;
+	}
+	template<typename table_t>
+	int run(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+		int pcm_samples = dsd_samples / decimation;
+		int radix = fir_ctables->radix;
+		int ctables = fir_ctables->count;
+		for (int sample = 0; sample < pcm_samples; sample++) {
+			for (int i = 0; i < decimation; i++) {
+				uint8_t* buf_lo = fir_buffer + fir_index * channels;
+				uint8_t* buf_hi = fir_buffer + (fir_index + fir_length) * channels;
+				for (int ch = 0; ch < channels; ch++) {
+					buf_hi[ch] = buf_lo[ch] = dsd_data[ch];
+				}
+				dsd_data += channels;
+				fir_index = (fir_index + 1) % fir_length;
+			}
+			accum_t* out = fir_accum;
+			for (int ch = 0; ch < channels; ch++) {
+				out[ch] = 0;
+			}
+			const uint8_t* fir_window = fir_buffer + fir_index * channels;
+			if (fir_ctables->mirrors > 0) {
+				int mirrors = fir_ctables->mirrors;
+				for (int j = 0; j < ctables; j++) {
+					const table_t* ctable = fir_ctables->get<table_t>(j);
+					for (int ch = 0; ch < channels; ch++) {
+						out[ch] += ctable[ctable_t::get_index(fir_window + ch, channels, j * radix, radix)];
+					}
+					if (j < mirrors) {
+						for (int ch = 0; ch < channels; ch++) {
+							out[ch] += ctable[fir_ctables->get_mirror_index(fir_window + ch, channels, j)];
+						}
+					}
+				}
+			}
+			else if (radix == 8) {
+				for (int j = 0; j < ctables; j++) {
+					const table_t* ctable = fir_ctables->get<table_t>(j);
+					const uint8_t* buf = fir_window + j * channels;
+					for (int ch = 0; ch < channels; ch++) {
+						out[ch] += ctable[buf[ch]];
+					}
+				}
+			}
+			else {
+				for (int j = 0; j < ctables; j++) {
+					const table_t* ctable = fir_ctables->get<table_t>(j);
+					for (int ch = 0; ch < channels; ch++) {
+						out[ch] += ctable[ctable_t::get_index(fir_window + ch, channels, j * radix, radix)];
+					}
+				}
+			}
+			for (int ch = 0; ch < channels; ch++) {
+				pcm_data[sample * channels + ch] = DSDPCMSample<real_t>::from_sum(out[ch]);
+			}
+		}
+		return pcm_samples;
+	}
+};
@@ -21,10 +21,11 @@
 
 #include "DSDPCMConstants.h"
 #include "Fir_IPP.h"
+#include "DSDPCMFilterSetup.h"
 
 template<typename real_t>
 class DSDPCMFir {
-	using ctable_t = real_t[256];
+	using ctable_t = DSDPCMCTables;
 	ctable_t* fir_ctables;
 	int       fir_order;
 	int       fir_length;
@@ -51,7 +52,7 @@ public:
 		return decimation;
 	}
 	float get_delay() {
-		return (float)fir_order / 2 / 8 / decimation;
+		return (fir_ctables->fir_delay + 8 * fir_length - fir_order) / 8 / decimation - 1;
 	}
 	void init(ctable_t* fir_ctables, int fir_length, int decimation) {
 		this->fir_ctables = fir_ctables;
@@ -77,10 +78,10 @@ public:
 		int fir_index = 0;
 		for (int sample = 0; sample < pcm_samples; sample++) {
 			for (int j = 0; j < fir_length - fir_index; j++) {
-				fir_out[j] = fir_ctables[j][fir_dly[fir_index + j]];
+				fir_out[j] = fir_ctables->get<real_t>(j)[fir_dly[fir_index + j]];
 			}
 			for (int j = max(fir_length - fir_index, 0); j < fir_length; j++) {
-				fir_out[j] = fir_ctables[j][dsd_data[j - (fir_length - fir_index)]];
+				fir_out[j] = fir_ctables->get<real_t>(j)[dsd_data[j - (fir_length - fir_index)]];
 			}
 			fir_index += decimation;
 			Fir_IPP::Sum(fir_out, fir_length, &pcm_data[sample]);
@@ -90,15 +91,16 @@ public:
 	}
 };
 
-int DSDPCMFir<float>::run(uint8_t* dsd_data, float* pcm_data, int dsd_samples) {
+template<>
+inline int DSDPCMFir<float>::run(uint8_t* dsd_data, float* pcm_data, int dsd_samples) {
 	int pcm_samples = dsd_samples / decimation;
 	int fir_index = 0;
 	for (int sample = 0; sample < pcm_samples; sample++) {
 		for (int j = 0; j < fir_length - fir_index; j++) {
-			fir_out[j] = fir_ctables[j][fir_dly[fir_index + j]];
+			fir_out[j] = fir_ctables->get<float>(j)[fir_dly[fir_index + j]];
 		}
 		for (int j = max(fir_length - fir_index, 0); j < fir_length; j++) {
-			fir_out[j] = fir_ctables[j][dsd_data[j - (fir_length - fir_index)]];
+			fir_out[j] = fir_ctables->get<float>(j)[dsd_data[j - (fir_length - fir_index)]];
 		}
 		fir_index += decimation;
 		Fir_IPP::Sum(fir_out, fir_length, &pcm_data[sample]);
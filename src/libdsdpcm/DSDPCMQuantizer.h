@@ -0,0 +1,292 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include "DSDPCMConstants.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define DSDPCM_QUANTIZER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DSDPCM_QUANTIZER_SSE2
+#endif
+
+enum pcm_format_e {
+	DSDPCM_PCM_FLOAT32 = 0,
+	DSDPCM_PCM_INT16   = 1,
+	DSDPCM_PCM_INT24   = 2,
+	DSDPCM_PCM_INT32   = 3
+};
+
+/*
+* Writes one channel of converter output into an interleaved buffer in the
+* given format. Integer samples are little-endian and packed (int24 takes
+* three bytes), as in WAV/W64 payloads. The TPDF dither (+-1 LSB) is a hash
+* of a per-channel sample counter, so the plain loop carries no state from
+* sample to sample. It runs four samples a step with AVX2, two with SSE2,
+* and in scalar code on other targets; the vector loop repeats the scalar
+* arithmetic and writes the same samples. The second-order noise shaper feeds back
+* the last two errors and runs sample by sample. Unclipped errors stay within
+* +-1.5 LSB, the fed back error is held to +-2 LSB so that clipping does not
+* wind the shaper up.
+*/
+
+class DSDPCMQuantizer {
+	int      channels;
+	bool     dither;
+	bool     noise_shaping;
+	bool     vectorized;
+	uint32_t dither_index[DSDPCM_MAX_CHANNELS];
+	double   shaping_error1[DSDPCM_MAX_CHANNELS];
+	double   shaping_error2[DSDPCM_MAX_CHANNELS];
+public:
+	DSDPCMQuantizer() {
+		channels = 0;
+		dither = false;
+		noise_shaping = false;
+		vectorized = true;
+	}
+	static int get_sample_bytes(pcm_format_e format) {
+		switch (format) {
+		case DSDPCM_PCM_INT16:
+			return 2;
+		case DSDPCM_PCM_INT24:
+			return 3;
+		default:
+			return 4;
+		}
+	}
+	void init(int channels, bool dither, bool noise_shaping, bool vectorized = true) {
+		this->channels = channels;
+		this->dither = dither;
+		this->noise_shaping = noise_shaping;
+		this->vectorized = vectorized;
+		for (int ch = 0; ch < DSDPCM_MAX_CHANNELS; ch++) {
+			dither_index[ch] = 0;
+			shaping_error1[ch] = 0.0;
+			shaping_error2[ch] = 0.0;
+		}
+	}
+	template<typename real_t>
+	void run(pcm_format_e format, int ch, const real_t* pcm_data, int pcm_stride, int pcm_samples, double gain, void* out_data) {
+		switch (format) {
+		case DSDPCM_PCM_INT16:
+			run_int<real_t, 2>(ch, pcm_data, pcm_stride, pcm_samples, gain, (uint8_t*)out_data + ch * 2);
+			break;
+		case DSDPCM_PCM_INT24:
+			run_int<real_t, 3>(ch, pcm_data, pcm_stride, pcm_samples, gain, (uint8_t*)out_data + ch * 3);
+			break;
+		case DSDPCM_PCM_INT32:
+			run_int<real_t, 4>(ch, pcm_data, pcm_stride, pcm_samples, gain, (uint8_t*)out_data + ch * 4);
+			break;
+		default:
+			float* out = (float*)out_data + ch;
+			for (int sample = 0; sample < pcm_samples; sample++) {
+				out[sample * channels] = (float)(pcm_data[sample * pcm_stride] * gain);
+			}
+			break;
+		}
+	}
+private:
+	static uint32_t hash(uint32_t x) {
+		x ^= x >> 16;
+		x *= 0x7feb352d;
+		x ^= x >> 15;
+		x *= 0x846ca68b;
+		x ^= x >> 16;
+		return x;
+	}
+	static double get_dither(uint32_t seed, uint32_t index) {
+		int32_t r1 = (int32_t)hash(seed + 2 * index);
+		int32_t r2 = (int32_t)hash(seed + 2 * index + 1);
+		return ((double)r1 + (double)r2) * (1.0 / 4294967296.0);
+	}
+	template<int bytes>
+	static int32_t quantize(double value) {
+		// rounds by truncating the value shifted to the positive range
+		const int64_t offset = (int64_t)1 << (8 * bytes - 1);
+		value += (double)offset + 0.5;
+		value = value > (double)(2 * offset - 1) ? (double)(2 * offset - 1) : value;
+		value = value < 0.0 ? 0.0 : value;
+		if (bytes < 4) {
+			return (int32_t)value - (int32_t)offset;
+		}
+		return (int32_t)((int64_t)value - offset);
+	}
+	template<int bytes>
+	static void put_sample(uint8_t* out, int32_t sample) {
+		out[0] = (uint8_t)sample;
+		out[1] = (uint8_t)(sample >> 8);
+		if (bytes > 2) {
+			out[2] = (uint8_t)(sample >> 16);
+		}
+		if (bytes > 3) {
+			out[3] = (uint8_t)(sample >> 24);
+		}
+	}
+	template<typename real_t, int bytes>
+	void run_int(int ch, const real_t* pcm_data, int pcm_stride, int pcm_samples, double gain, uint8_t* out) {
+		double scale = gain * (double)((int64_t)1 << (8 * bytes - 1));
+		double dither_scale = dither ? 1.0 : 0.0;
+		int out_stride = channels * bytes;
+		uint32_t seed = hash(ch + 1);
+		uint32_t index = dither_index[ch];
+		if (noise_shaping) {
+			double e1 = shaping_error1[ch];
+			double e2 = shaping_error2[ch];
+			for (int sample = 0; sample < pcm_samples; sample++) {
+				double value = pcm_data[sample * pcm_stride] * scale - 2.0 * e1 + e2;
+				int32_t q = quantize<bytes>(value + dither_scale * get_dither(seed, index + sample));
+				e2 = e1;
+				e1 = q - value;
+				e1 = e1 > 2.0 ? 2.0 : e1;
+				e1 = e1 < -2.0 ? -2.0 : e1;
+				put_sample<bytes>(out + sample * out_stride, q);
+			}
+			shaping_error1[ch] = e1;
+			shaping_error2[ch] = e2;
+		}
+		else {
+			int sample = vectorized ? run_vector<real_t, bytes>(pcm_data, pcm_stride, pcm_samples, scale, dither, seed, index, out, out_stride) : 0;
+			for (; sample < pcm_samples; sample++) {
+				double value = pcm_data[sample * pcm_stride] * scale;
+				int32_t q = quantize<bytes>(value + dither_scale * get_dither(seed, index + sample));
+				put_sample<bytes>(out + sample * out_stride, q);
+			}
+		}
+		dither_index[ch] = index + pcm_samples;
+	}
+#if defined(DSDPCM_QUANTIZER_AVX2)
+	static __m128i hash_vector(__m128i x) {
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+		x = _mm_mullo_epi32(x, _mm_set1_epi32(0x7feb352d));
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+		x = _mm_mullo_epi32(x, _mm_set1_epi32((int)0x846ca68b));
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+		return x;
+	}
+	template<typename real_t>
+	static __m256d load_vector(const real_t* pcm_data, int pcm_stride) {
+		return _mm256_setr_pd((double)pcm_data[0], (double)pcm_data[pcm_stride], (double)pcm_data[2 * pcm_stride], (double)pcm_data[3 * pcm_stride]);
+	}
+	static __m256d load_vector(const double* pcm_data, int pcm_stride) {
+		if (pcm_stride == 1) {
+			return _mm256_loadu_pd(pcm_data);
+		}
+		return _mm256_setr_pd(pcm_data[0], pcm_data[pcm_stride], pcm_data[2 * pcm_stride], pcm_data[3 * pcm_stride]);
+	}
+	static __m256d load_vector(const float* pcm_data, int pcm_stride) {
+		if (pcm_stride == 1) {
+			return _mm256_cvtps_pd(_mm_loadu_ps(pcm_data));
+		}
+		return _mm256_setr_pd(pcm_data[0], pcm_data[pcm_stride], pcm_data[2 * pcm_stride], pcm_data[3 * pcm_stride]);
+	}
+	template<typename real_t, int bytes>
+	static int run_vector(const real_t* pcm_data, int pcm_stride, int pcm_samples, double scale, bool dither, uint32_t seed, uint32_t index, uint8_t* out, int out_stride) {
+		const double offset = (double)((int64_t)1 << (8 * bytes - 1));
+		__m256d v_scale = _mm256_set1_pd(scale);
+		__m256d v_unit = _mm256_set1_pd(1.0 / 4294967296.0);
+		__m256d v_round = _mm256_set1_pd(offset + 0.5);
+		__m256d v_max = _mm256_set1_pd(2.0 * offset - 1.0);
+		__m256d v_offset = _mm256_set1_pd(offset);
+		__m128i v_index = _mm_add_epi32(_mm_set1_epi32((int)(seed + 2 * index)), _mm_setr_epi32(0, 2, 4, 6));
+		int32_t q[4];
+		int sample = 0;
+		for (; sample + 4 <= pcm_samples; sample += 4) {
+			__m256d value = _mm256_mul_pd(load_vector(pcm_data + sample * pcm_stride, pcm_stride), v_scale);
+			if (dither) {
+				__m256d r1 = _mm256_cvtepi32_pd(hash_vector(v_index));
+				__m256d r2 = _mm256_cvtepi32_pd(hash_vector(_mm_add_epi32(v_index, _mm_set1_epi32(1))));
+				value = _mm256_add_pd(value, _mm256_mul_pd(_mm256_add_pd(r1, r2), v_unit));
+				v_index = _mm_add_epi32(v_index, _mm_set1_epi32(8));
+			}
+			value = _mm256_add_pd(value, v_round);
+			value = _mm256_max_pd(_mm256_min_pd(value, v_max), _mm256_setzero_pd());
+			_mm_storeu_si128((__m128i*)q, _mm256_cvttpd_epi32(_mm256_sub_pd(_mm256_floor_pd(value), v_offset)));
+			for (int i = 0; i < 4; i++) {
+				put_sample<bytes>(out + (sample + i) * out_stride, q[i]);
+			}
+		}
+		return sample;
+	}
+#elif defined(DSDPCM_QUANTIZER_SSE2)
+	static __m128i mullo_vector(__m128i x, uint32_t y) {
+		__m128i v_y = _mm_set1_epi32((int)y);
+		__m128i even = _mm_mul_epu32(x, v_y);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), v_y);
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+	static __m128i hash_vector(__m128i x) {
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+		x = mullo_vector(x, 0x7feb352d);
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+		x = mullo_vector(x, 0x846ca68b);
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+		return x;
+	}
+	template<typename real_t>
+	static __m128d load_vector(const real_t* pcm_data, int pcm_stride) {
+		return _mm_setr_pd((double)pcm_data[0], (double)pcm_data[pcm_stride]);
+	}
+	template<typename real_t, int bytes>
+	static int run_vector(const real_t* pcm_data, int pcm_stride, int pcm_samples, double scale, bool dither, uint32_t seed, uint32_t index, uint8_t* out, int out_stride) {
+		const double offset = (double)((int64_t)1 << (8 * bytes - 1));
+		__m128d v_scale = _mm_set1_pd(scale);
+		__m128d v_unit = _mm_set1_pd(1.0 / 4294967296.0);
+		__m128d v_round = _mm_set1_pd(offset + 0.5);
+		__m128d v_max = _mm_set1_pd(2.0 * offset - 1.0);
+		__m128d v_offset = _mm_set1_pd(offset);
+		__m128d v_integer = _mm_set1_pd(4503599627370496.0);
+		__m128d v_one = _mm_set1_pd(1.0);
+		// both dither terms of two samples in one vector: r1, r2 of the first, then of the second
+		__m128i v_index = _mm_add_epi32(_mm_set1_epi32((int)(seed + 2 * index)), _mm_setr_epi32(0, 1, 2, 3));
+		int32_t q[2];
+		int sample = 0;
+		for (; sample + 2 <= pcm_samples; sample += 2) {
+			__m128d value = _mm_mul_pd(load_vector(pcm_data + sample * pcm_stride, pcm_stride), v_scale);
+			if (dither) {
+				__m128i r = _mm_shuffle_epi32(hash_vector(v_index), _MM_SHUFFLE(3, 1, 2, 0));
+				__m128d r1 = _mm_cvtepi32_pd(r);
+				__m128d r2 = _mm_cvtepi32_pd(_mm_srli_si128(r, 8));
+				value = _mm_add_pd(value, _mm_mul_pd(_mm_add_pd(r1, r2), v_unit));
+				v_index = _mm_add_epi32(v_index, _mm_set1_epi32(4));
+			}
+			value = _mm_add_pd(value, v_round);
+			value = _mm_max_pd(_mm_min_pd(value, v_max), _mm_setzero_pd());
+			// floor of a value in [0, 2^52): round to an integer by adding 2^52, step back where that rounded up
+			__m128d floor = _mm_sub_pd(_mm_add_pd(value, v_integer), v_integer);
+			floor = _mm_sub_pd(floor, _mm_and_pd(_mm_cmpgt_pd(floor, value), v_one));
+			_mm_storel_epi64((__m128i*)q, _mm_cvttpd_epi32(_mm_sub_pd(floor, v_offset)));
+			put_sample<bytes>(out + sample * out_stride, q[0]);
+			put_sample<bytes>(out + (sample + 1) * out_stride, q[1]);
+		}
+		return sample;
+	}
+#else
+	template<typename real_t, int bytes>
+	static int run_vector(const real_t* pcm_data, int pcm_stride, int pcm_samples, double scale, bool dither, uint32_t seed, uint32_t index, uint8_t* out, int out_stride) {
+		return 0;
+	}
+#endif
+};
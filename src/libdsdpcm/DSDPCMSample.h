@@ -0,0 +1,103 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#define DSDPCM_FIXED_SAMPLE_BITS 28
+#define DSDPCM_FIXED_COEF_BITS   31
+#define DSDPCM_FIXED_GAIN_BITS   27
+#define DSDPCM_MAX_GAIN          16.0
+
+/*
+* Sample arithmetic of the converter templates. Floating point streams
+* accumulate in their own type. The fixed point stream (int32_t) carries
+* samples in Q28 and PCM coefficients in Q31, sums in int64_t and rounds
+* once per output sample, so the result does not depend on the compiler,
+* the CPU or the vector width. Gains (the downmix matrix) are Q27 and stay
+* below DSDPCM_MAX_GAIN in magnitude.
+*/
+
+template<typename real_t>
+class DSDPCMSample {
+public:
+	using accum_t = real_t;
+	static const bool fixed = false;
+	static real_t make_value(double value) {
+		return (real_t)value;
+	}
+	static real_t make_coef(double coef) {
+		return (real_t)coef;
+	}
+	static accum_t mul(real_t coef, real_t value) {
+		return coef * value;
+	}
+	static real_t from_sum(accum_t sum) {
+		return sum;
+	}
+	static real_t from_dot(accum_t dot) {
+		return dot;
+	}
+	static real_t make_gain(double gain) {
+		return (real_t)gain;
+	}
+	static real_t from_gain(accum_t dot) {
+		return dot;
+	}
+	static double get_unit() {
+		return 1.0;
+	}
+};
+
+template<>
+class DSDPCMSample<int32_t> {
+public:
+	using accum_t = int64_t;
+	static const bool fixed = true;
+	static int32_t make_value(double value) {
+		return saturate(llround(value * (double)((int64_t)1 << DSDPCM_FIXED_SAMPLE_BITS)));
+	}
+	static int32_t make_coef(double coef) {
+		return saturate(llround(coef * (double)((int64_t)1 << DSDPCM_FIXED_COEF_BITS)));
+	}
+	static int64_t mul(int32_t coef, int32_t value) {
+		return (int64_t)coef * value;
+	}
+	static int32_t from_sum(int64_t sum) {
+		return saturate(sum);
+	}
+	static int32_t from_dot(int64_t dot) {
+		return saturate((dot + ((int64_t)1 << (DSDPCM_FIXED_COEF_BITS - 1))) >> DSDPCM_FIXED_COEF_BITS);
+	}
+	static int32_t make_gain(double gain) {
+		return saturate(llround(gain * (double)((int64_t)1 << DSDPCM_FIXED_GAIN_BITS)));
+	}
+	static int32_t from_gain(int64_t dot) {
+		return saturate((dot + ((int64_t)1 << (DSDPCM_FIXED_GAIN_BITS - 1))) >> DSDPCM_FIXED_GAIN_BITS);
+	}
+	static double get_unit() {
+		return 1.0 / (double)((int64_t)1 << DSDPCM_FIXED_SAMPLE_BITS);
+	}
+private:
+	static int32_t saturate(int64_t value) {
+		return (int32_t)((value > INT32_MAX) ? INT32_MAX : (value < INT32_MIN) ? INT32_MIN : value);
+	}
+};
@@ -21,23 +21,145 @@
 
 #include <memory.h>
 #include <stdlib.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include "DSDPCMConstants.h"
+#include "DSDPCMArena.h"
 
 extern bool g_fir_initialized;
 
 class DSDPCMUtil {
 public:
+	/*
+	* Every block is preceded by MEM_ALIGN bytes, the last two words of which
+	* tell mem_free where the block came from (and the mapping size).
+	*/
 	static void* mem_alloc(size_t size) {
-		void* memory = _aligned_malloc(size, MEM_ALIGN);
-		if (memory) {
-			memset(memory, 0, size);
+		DSDPCMArena* arena = DSDPCMArena::current();
+		if (arena) {
+			uint8_t* memory = (uint8_t*)arena->alloc(MEM_ALIGN + size);
+			if (memory) {
+				return set_block(memory, MEM_FROM_ARENA, 0);
+			}
+		}
+#ifdef _WIN32
+		void* memory = _aligned_malloc(MEM_ALIGN + size, MEM_ALIGN);
+#else
+		void* memory = nullptr;
+		if (posix_memalign(&memory, MEM_ALIGN, MEM_ALIGN + size) != 0) {
+			memory = nullptr;
+		}
+#endif
+		if (!memory) {
+			return nullptr;
+		}
+		memset(memory, 0, MEM_ALIGN + size);
+		return set_block((uint8_t*)memory, MEM_FROM_HEAP, 0);
+	}
+	/*
+	* Large long-lived blocks (lookup tables) shared between engines: mapped
+	* on their own with the requested pages, never from the current arena.
+	*/
+	static void* mem_alloc_pages(size_t size, arena_pages_e pages) {
+		if (pages == DSDPCM_PAGES_NORMAL) {
+			DSDPCMArenaScope heap_scope(nullptr);
+			return mem_alloc(size);
+		}
+		size_t map_size = MEM_ALIGN + size;
+		uint8_t* memory = (uint8_t*)DSDPCMArena::map(map_size, pages);
+		if (!memory) {
+			return nullptr;
 		}
-		return memory;
+		return set_block(memory, MEM_FROM_MAP, map_size);
 	}
 	static void mem_free(void* memory) {
 		if (memory) {
-			_aligned_free(memory);
+			size_t* block = (size_t*)memory;
+			uint8_t* base = (uint8_t*)memory - MEM_ALIGN;
+			switch (block[-1]) {
+			case MEM_FROM_HEAP:
+#ifdef _WIN32
+				_aligned_free(base);
+#else
+				free(base);
+#endif
+				break;
+			case MEM_FROM_MAP:
+				DSDPCMArena::unmap(base, block[-2]);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+	/*
+	* MSVC emits POPCNT for __popcnt without checking the CPU, so it is only
+	* used once CPUID reports it; __popcnt64 exists on x64 only. GCC and clang
+	* fall back to a library call unless POPCNT is enabled at compile time.
+	*/
+	static bool is_silence(const uint8_t* dsd_data, int dsd_samples) {
+		for (int sample = 0; sample < dsd_samples; sample++) {
+			if (dsd_data[sample] != DSD_SILENCE_BYTE) {
+				return false;
+			}
 		}
+		return true;
+	}
+	static int popcount(uint64_t bits) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		if (has_popcnt()) {
+#ifdef _M_X64
+			return (int)__popcnt64(bits);
+#else
+			return (int)(__popcnt((unsigned int)bits) + __popcnt((unsigned int)(bits >> 32)));
+#endif
+		}
+		return popcount_swar(bits);
+#elif defined(__GNUC__)
+		return __builtin_popcountll(bits);
+#else
+		return popcount_swar(bits);
+#endif
+	}
+	static int popcount_swar(uint64_t bits) {
+		bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+		bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+		bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0full;
+		return (int)((bits * 0x0101010101010101ull) >> 56);
+	}
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	static bool has_popcnt() {
+		static const bool popcnt = [] {
+			int cpu_info[4];
+			__cpuid(cpu_info, 1);
+			return (cpu_info[2] & (1 << 23)) != 0;
+		}();
+		return popcnt;
+	}
+#endif
+	template<typename coef_t>
+	static float get_fir_delay(const coef_t* fir_coefs, int fir_length) {
+		double sum = 0.0;
+		double moment = 0.0;
+		bool symmetric = true;
+		for (int i = 0; i < fir_length; i++) {
+			sum += fir_coefs[i];
+			moment += (double)i * fir_coefs[i];
+			symmetric = symmetric && fir_coefs[i] == fir_coefs[fir_length - 1 - i];
+		}
+		if (symmetric || sum == 0.0) {
+			return (float)(fir_length - 1) / 2;
+		}
+		return (float)(moment / sum);
+	}
+private:
+	enum { MEM_FROM_ARENA = 0x41524e41, MEM_FROM_HEAP = 0x48454150, MEM_FROM_MAP = 0x4d415050 };
+	static void* set_block(uint8_t* memory, size_t from, size_t size) {
+		size_t* block = (size_t*)(memory + MEM_ALIGN);
+		block[-1] = from;
+		block[-2] = size;
+		return block;
 	}
 };
\ No newline at end of file
@@ -21,36 +21,44 @@
 
 #include "DSDPCMConstants.h"
 #include "DSDPCMUtil.h"
+#include "DSDPCMSample.h"
 
 template<typename real_t>
 class PCMPCMFir {
+	using accum_t = typename DSDPCMSample<real_t>::accum_t;
 	real_t* fir_coefs;
 	int     fir_order;
+	float   fir_delay;
 	int     fir_length;
 	int     decimation;
 	real_t* fir_buffer;
 	int     fir_index;
+	bool    sum_fp64;
 public:
 	PCMPCMFir() {
 		fir_coefs = nullptr;
 		fir_order = 0;
+		fir_delay = 0.0f;
 		fir_length = 0;
 		decimation = 0;
 		fir_buffer = nullptr;
 		fir_index = 0;
+		sum_fp64 = false;
 	}
 	~PCMPCMFir() {
 		free();
 	}
-	void init(real_t* fir_coefs, int fir_length, int decimation) {
+	void init(real_t* fir_coefs, int fir_length, int decimation, bool sum_fp64 = false) {
 		this->fir_coefs = fir_coefs;
 		this->fir_order = fir_length - 1;
+		this->fir_delay = (float)this->fir_order - DSDPCMUtil::get_fir_delay(fir_coefs, fir_length);
 		this->fir_length = fir_length;
 		this->decimation = decimation;
 		int buf_size = 2 * this->fir_length * sizeof(real_t);
 		this->fir_buffer = (real_t*)DSDPCMUtil::mem_alloc(buf_size);
 		memset(this->fir_buffer, 0, buf_size);
 		fir_index = 0;
+		this->sum_fp64 = sum_fp64 && !DSDPCMSample<real_t>::fixed;
 	}
 	void free() {
 		if (fir_buffer) {
@@ -62,8 +70,16 @@ public:
 		return decimation;
 	}
 	float get_delay() {
-		return (float)fir_order / 2 / decimation;
+		return (fir_delay + 1) / decimation - 1;
 	}
+	int run(real_t* pcm_data, real_t* out_data, int pcm_samples) {
+		if (sum_fp64) {
+			return run<double>(pcm_data, out_data, pcm_samples);
+		}
+		return run<accum_t>(pcm_data, out_data, pcm_samples);
+	}
+private:
+	template<typename sum_t>
 	int run(real_t* pcm_data, real_t* out_data, int pcm_samples) {
 		int out_samples = pcm_samples / decimation;
 		for (int sample = 0; sample < out_samples; sample++) {
@@ -71,10 +87,11 @@ public:
 				fir_buffer[fir_index + fir_length] = fir_buffer[fir_index] = *(pcm_data++);
 				fir_index = (++fir_index) % fir_length;
 			}
-			out_data[sample] = (real_t)0;
+			sum_t out_sample = 0;
 			for (int j = 0; j < fir_length; j++) {
-				out_data[sample] += fir_coefs[j] * fir_buffer[fir_index + j];
+				out_sample += (sum_t)fir_coefs[j] * fir_buffer[fir_index + j];
 			}
+			out_data[sample] = DSDPCMSample<real_t>::from_dot((accum_t)out_sample);
 		}
 		return out_samples;
 	}
@@ -0,0 +1,229 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <math.h>
+
+#include "DSDPCMConstants.h"
+#include "DSDPCMUtil.h"
+#include "DSDPCMFFT.h"
+
+/*
+* Decimating FIR as a uniformly partitioned overlap-save convolution.
+* The filter is split into D polyphase branches running at the output rate,
+* every branch into P partitions of B taps. Each block of B outputs costs
+* D/2 forward FFTs (two real branches per complex FFT), D*P spectrum MACs and
+* one inverse FFT, independent of the tap count. Output lags by B samples.
+* Coefficients are in natural order (fir_coefs[0] weights the newest input).
+*/
+
+template<typename real_t>
+class PCMPCMFirFFT {
+	using complex_t = std::complex<real_t>;
+	DSDPCMFFT<real_t> fft;
+	int        fir_length;
+	int        decimation;
+	int        block_size;
+	int        partitions;
+	int        bins;
+	float      fir_delay;
+	real_t*    fir_spectra;
+	real_t*    inp_spectra;
+	real_t*    acc_spectrum;
+	complex_t* fft_buffer;
+	real_t*    inp_buffer;
+	int        inp_count;
+	int        inp_index;
+	real_t*    out_buffer;
+	int        out_count;
+	int        out_index;
+public:
+	PCMPCMFirFFT() {
+		fir_length = 0;
+		decimation = 0;
+		block_size = 0;
+		partitions = 0;
+		bins = 0;
+		fir_delay = 0.0f;
+		fir_spectra = nullptr;
+		inp_spectra = nullptr;
+		acc_spectrum = nullptr;
+		fft_buffer = nullptr;
+		inp_buffer = nullptr;
+		inp_count = 0;
+		inp_index = 0;
+		out_buffer = nullptr;
+		out_count = 0;
+		out_index = 0;
+	}
+	~PCMPCMFirFFT() {
+		free();
+	}
+	void init(const double* fir_coefs, int fir_length, double fir_gain, int decimation, int block_size) {
+		free();
+		this->fir_length = fir_length;
+		this->decimation = decimation;
+		this->block_size = block_size;
+		int branch_length = (fir_length + decimation - 1) / decimation;
+		partitions = (branch_length + block_size - 1) / block_size;
+		bins = block_size + 1;
+		fir_delay = DSDPCMUtil::get_fir_delay(fir_coefs, fir_length);
+		fft.init(2 * block_size);
+		fir_spectra = (real_t*)DSDPCMUtil::mem_alloc((size_t)decimation * partitions * bins * 2 * sizeof(real_t));
+		inp_spectra = (real_t*)DSDPCMUtil::mem_alloc((size_t)partitions * decimation * bins * 2 * sizeof(real_t));
+		acc_spectrum = (real_t*)DSDPCMUtil::mem_alloc(bins * 2 * sizeof(real_t));
+		fft_buffer = (complex_t*)DSDPCMUtil::mem_alloc(2 * block_size * sizeof(complex_t));
+		inp_buffer = (real_t*)DSDPCMUtil::mem_alloc((size_t)decimation * 2 * block_size * sizeof(real_t));
+		out_buffer = (real_t*)DSDPCMUtil::mem_alloc(2 * block_size * sizeof(real_t));
+		for (int p = 0; p < decimation; p++) {
+			for (int q = 0; q < partitions; q++) {
+				for (int j = 0; j < 2 * block_size; j++) {
+					int n = (q * block_size + j) * decimation + p;
+					fft_buffer[j] = (j < block_size && n < fir_length) ? (real_t)(fir_coefs[n] * fir_gain) : (real_t)0;
+				}
+				fft.forward(fft_buffer);
+				real_t* spectrum = fir_spectra + ((size_t)p * partitions + q) * bins * 2;
+				for (int k = 0; k < bins; k++) {
+					spectrum[2 * k + 0] = fft_buffer[k].real();
+					spectrum[2 * k + 1] = fft_buffer[k].imag();
+				}
+			}
+		}
+		inp_count = 0;
+		inp_index = 0;
+		out_count = block_size;
+		out_index = 0;
+	}
+	void free() {
+		fft.free();
+		DSDPCMUtil::mem_free(fir_spectra);
+		fir_spectra = nullptr;
+		DSDPCMUtil::mem_free(inp_spectra);
+		inp_spectra = nullptr;
+		DSDPCMUtil::mem_free(acc_spectrum);
+		acc_spectrum = nullptr;
+		DSDPCMUtil::mem_free(fft_buffer);
+		fft_buffer = nullptr;
+		DSDPCMUtil::mem_free(inp_buffer);
+		inp_buffer = nullptr;
+		DSDPCMUtil::mem_free(out_buffer);
+		out_buffer = nullptr;
+	}
+	int get_decimation() {
+		return decimation;
+	}
+	int get_block_size() {
+		return block_size;
+	}
+	float get_delay() {
+		return (fir_delay + 1) / decimation - 1 + block_size;
+	}
+	void clear_output() {
+		memset(out_buffer + out_index, 0, (out_count - out_index) * sizeof(real_t));
+	}
+	int run(real_t* pcm_data, real_t* out_data, int pcm_samples) {
+		int out_samples = pcm_samples / decimation;
+		for (int sample = 0; sample < out_samples; sample++) {
+			real_t* inp = inp_buffer + block_size + inp_count;
+			for (int p = 0; p < decimation; p++) {
+				inp[p * 2 * block_size] = pcm_data[decimation - 1 - p];
+			}
+			pcm_data += decimation;
+			if (++inp_count == block_size) {
+				run_block();
+				inp_count = 0;
+			}
+			out_data[sample] = out_buffer[out_index++];
+		}
+		return out_samples;
+	}
+	static double get_cost(int fir_length, int decimation, int block_size) {
+		int branch_length = (fir_length + decimation - 1) / decimation;
+		int partitions = (branch_length + block_size - 1) / block_size;
+		double fft_ops = 5.0 * (2 * block_size) * log((double)(2 * block_size)) / log(2.0);
+		double mac_ops = 8.0 * decimation * partitions * (block_size + 1);
+		return (((decimation + 1) / 2 + 1) * fft_ops + mac_ops) / block_size;
+	}
+	static int select_block_size(int fir_length, int decimation) {
+		int best_size = 64;
+		for (int block_size = 128; block_size <= 8192; block_size *= 2) {
+			if (get_cost(fir_length, decimation, block_size) < get_cost(fir_length, decimation, best_size)) {
+				best_size = block_size;
+			}
+		}
+		return best_size;
+	}
+private:
+	void run_block() {
+		int fft_size = 2 * block_size;
+		real_t* slot_spectra = inp_spectra + (size_t)inp_index * decimation * bins * 2;
+		for (int p = 0; p < decimation; p += 2) {
+			real_t* inp_a = inp_buffer + (size_t)p * fft_size;
+			real_t* inp_b = (p + 1 < decimation) ? inp_a + fft_size : nullptr;
+			for (int i = 0; i < fft_size; i++) {
+				fft_buffer[i] = complex_t(inp_a[i], inp_b ? inp_b[i] : (real_t)0);
+			}
+			fft.forward(fft_buffer);
+			real_t* spectrum_a = slot_spectra + (size_t)p * bins * 2;
+			real_t* spectrum_b = spectrum_a + bins * 2;
+			for (int k = 0; k < bins; k++) {
+				complex_t z = fft_buffer[k];
+				complex_t w = std::conj(fft_buffer[(fft_size - k) & (fft_size - 1)]);
+				spectrum_a[2 * k + 0] = (z.real() + w.real()) / 2;
+				spectrum_a[2 * k + 1] = (z.imag() + w.imag()) / 2;
+				if (inp_b) {
+					spectrum_b[2 * k + 0] = (z.imag() - w.imag()) / 2;
+					spectrum_b[2 * k + 1] = (w.real() - z.real()) / 2;
+				}
+			}
+			memcpy(inp_a, inp_a + block_size, block_size * sizeof(real_t));
+			if (inp_b) {
+				memcpy(inp_b, inp_b + block_size, block_size * sizeof(real_t));
+			}
+		}
+		memset(acc_spectrum, 0, bins * 2 * sizeof(real_t));
+		for (int q = 0; q < partitions; q++) {
+			int slot = (inp_index - q + partitions) % partitions;
+			for (int p = 0; p < decimation; p++) {
+				const real_t* x = inp_spectra + ((size_t)slot * decimation + p) * bins * 2;
+				const real_t* h = fir_spectra + ((size_t)p * partitions + q) * bins * 2;
+				for (int k = 0; k < bins; k++) {
+					acc_spectrum[2 * k + 0] += h[2 * k + 0] * x[2 * k + 0] - h[2 * k + 1] * x[2 * k + 1];
+					acc_spectrum[2 * k + 1] += h[2 * k + 0] * x[2 * k + 1] + h[2 * k + 1] * x[2 * k + 0];
+				}
+			}
+		}
+		inp_index = (inp_index + 1) % partitions;
+		for (int k = 0; k < bins; k++) {
+			fft_buffer[k] = complex_t(acc_spectrum[2 * k + 0], acc_spectrum[2 * k + 1]);
+		}
+		for (int k = 1; k < block_size; k++) {
+			fft_buffer[fft_size - k] = std::conj(fft_buffer[k]);
+		}
+		fft.inverse(fft_buffer);
+		out_count -= out_index;
+		memmove(out_buffer, out_buffer + out_index, out_count * sizeof(real_t));
+		out_index = 0;
+		for (int i = 0; i < block_size; i++) {
+			out_buffer[out_count + i] = fft_buffer[block_size + i].real();
+		}
+		out_count += block_size;
+	}
+};
@@ -0,0 +1,125 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "DSDPCMConstants.h"
+#include "DSDPCMUtil.h"
+#include "DSDPCMSample.h"
+
+/*
+* PCM FIR running all channels of an interleaved stream at once.
+* Each coefficient is broadcast against a contiguous row of channel samples.
+*/
+
+template<typename real_t>
+class PCMPCMFirLanes {
+	using accum_t = typename DSDPCMSample<real_t>::accum_t;
+	real_t* fir_coefs;
+	int     fir_order;
+	float   fir_delay;
+	int     fir_length;
+	int     decimation;
+	int     channels;
+	real_t* fir_buffer;
+	int     fir_index;
+	bool    sum_fp64;
+	void*   fir_accum;
+public:
+	PCMPCMFirLanes() {
+		fir_coefs = nullptr;
+		fir_order = 0;
+		fir_delay = 0.0f;
+		fir_length = 0;
+		decimation = 0;
+		channels = 0;
+		fir_buffer = nullptr;
+		fir_index = 0;
+		sum_fp64 = false;
+		fir_accum = nullptr;
+	}
+	~PCMPCMFirLanes() {
+		free();
+	}
+	void init(real_t* fir_coefs, int fir_length, int decimation, int channels, bool sum_fp64 = false) {
+		this->fir_coefs = fir_coefs;
+		this->fir_order = fir_length - 1;
+		this->fir_delay = (float)this->fir_order - DSDPCMUtil::get_fir_delay(fir_coefs, fir_length);
+		this->fir_length = fir_length;
+		this->decimation = decimation;
+		this->channels = channels;
+		int buf_size = 2 * this->fir_length * channels * sizeof(real_t);
+		this->fir_buffer = (real_t*)DSDPCMUtil::mem_alloc(buf_size);
+		memset(this->fir_buffer, 0, buf_size);
+		this->sum_fp64 = sum_fp64 && !DSDPCMSample<real_t>::fixed;
+		this->fir_accum = DSDPCMUtil::mem_alloc(channels * (this->sum_fp64 ? sizeof(double) : sizeof(accum_t)));
+		fir_index = 0;
+	}
+	void free() {
+		if (fir_buffer) {
+			DSDPCMUtil::mem_free(fir_buffer);
+			fir_buffer = nullptr;
+		}
+		DSDPCMUtil::mem_free(fir_accum);
+		fir_accum = nullptr;
+	}
+	int get_decimation() {
+		return decimation;
+	}
+	float get_delay() {
+		return (fir_delay + 1) / decimation - 1;
+	}
+	int run(real_t* pcm_data, real_t* out_data, int pcm_samples) {
+		if (sum_fp64) {
+			return run<double>(pcm_data, out_data, pcm_samples);
+		}
+		return run<accum_t>(pcm_data, out_data, pcm_samples);
+	}
+private:
+	template<typename sum_t>
+	int run(real_t* pcm_data, real_t* out_data, int pcm_samples) {
+		int out_samples = pcm_samples / decimation;
+		for (int sample = 0; sample < out_samples; sample++) {
+			for (int i = 0; i < decimation; i++) {
+				real_t* buf_lo = fir_buffer + fir_index * channels;
+				real_t* buf_hi = fir_buffer + (fir_index + fir_length) * channels;
+				for (int ch = 0; ch < channels; ch++) {
+					buf_hi[ch] = buf_lo[ch] = pcm_data[ch];
+				}
+				pcm_data += channels;
+				fir_index = (fir_index + 1) % fir_length;
+			}
+			sum_t* out = (sum_t*)fir_accum;
+			for (int ch = 0; ch < channels; ch++) {
+				out[ch] = 0;
+			}
+			for (int j = 0; j < fir_length; j++) {
+				const real_t coef = fir_coefs[j];
+				const real_t* buf = fir_buffer + (fir_index + j) * channels;
+				for (int ch = 0; ch < channels; ch++) {
+					out[ch] += (sum_t)coef * buf[ch];
+				}
+			}
+			for (int ch = 0; ch < channels; ch++) {
+				out_data[sample * channels + ch] = DSDPCMSample<real_t>::from_dot((accum_t)out[ch]);
+			}
+		}
+		return out_samples;
+	}
+};
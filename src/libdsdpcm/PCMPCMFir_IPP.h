@@ -20,6 +20,7 @@
 #pragma once
 
 #include "DSDPCMConstants.h"
+#include "DSDPCMUtil.h"
 #include "Fir_IPP.h"
 
 using IppsFIRSpec = void;
@@ -28,6 +29,7 @@ template<typename real_t>
 class PCMPCMFir {
 	real_t* fir_coefs;
 	int     fir_order;
+	float   fir_delay;
 	int     fir_length;
 	int     decimation;
 
@@ -42,6 +44,7 @@ public:
 		}
 		fir_coefs = nullptr;
 		fir_order = 0;
+		fir_delay = 0.0f;
 		fir_length = 0;
 		decimation = 0;
 
@@ -56,13 +59,14 @@ public:
 		return decimation;
 	}
 	float get_delay() {
-		return (float)fir_order / 2 / decimation;
+		return fir_delay / decimation;
 	}
-	void init(real_t* fir_coefs, int fir_length, int decimation) {
+	void init(real_t* fir_coefs, int fir_length, int decimation, bool = false) {
 		this->fir_coefs = fir_coefs;
 		this->fir_length = fir_length;
 		this->decimation = decimation;
 		fir_order = fir_length - 1;
+		fir_delay = (float)fir_order - DSDPCMUtil::get_fir_delay(fir_coefs, fir_length);
 		fir_dly = (sizeof(real_t) == sizeof(float)) ? reinterpret_cast<real_t*>(ippsMalloc_32f(fir_length)) : reinterpret_cast<real_t*>(ippsMalloc_64f(fir_length));
 		int specSize = 0;
 		int bufSize = 0;
@@ -0,0 +1,178 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <math.h>
+
+#include "DSDPCMConstants.h"
+#include "DSDPCMUtil.h"
+#include "DSDPCMSample.h"
+
+/*
+* Rational L/M polyphase resampler (Kaiser windowed sinc prototype).
+* Phase tables are stored time-reversed, so every output sample is a
+* contiguous dot product against the history buffer. Four partial sums keep
+* the dot product vectorizable without reassociation by the compiler.
+*/
+
+template<typename real_t>
+class PCMPCMResampler {
+	using accum_t = typename DSDPCMSample<real_t>::accum_t;
+	real_t* phase_coefs;
+	int     taps;
+	int     interpolation;
+	int     decimation;
+	int     channels;
+	real_t* fir_buffer;
+	int     fir_index;
+	int     phase;
+	bool    sum_fp64;
+public:
+	PCMPCMResampler() {
+		phase_coefs = nullptr;
+		taps = 0;
+		interpolation = 1;
+		decimation = 1;
+		channels = 0;
+		fir_buffer = nullptr;
+		fir_index = 0;
+		phase = 0;
+		sum_fp64 = false;
+	}
+	~PCMPCMResampler() {
+		free();
+	}
+	void init(int interpolation, int decimation, int taps, int channels, bool sum_fp64 = false) {
+		free();
+		this->taps = (taps + 3) & ~3;
+		this->interpolation = interpolation;
+		this->decimation = decimation;
+		this->channels = channels;
+		int fir_length = interpolation * this->taps;
+		double* fir_coefs = new double[fir_length];
+		make_coefs(fir_coefs, fir_length);
+		this->phase_coefs = (real_t*)DSDPCMUtil::mem_alloc(fir_length * sizeof(real_t));
+		for (int p = 0; p < interpolation; p++) {
+			for (int j = 0; j < this->taps; j++) {
+				phase_coefs[p * this->taps + j] = DSDPCMSample<real_t>::make_coef(fir_coefs[p + (this->taps - 1 - j) * interpolation]);
+			}
+		}
+		delete[] fir_coefs;
+		int buf_size = 2 * this->taps * channels * sizeof(real_t);
+		this->fir_buffer = (real_t*)DSDPCMUtil::mem_alloc(buf_size);
+		memset(this->fir_buffer, 0, buf_size);
+		fir_index = 0;
+		phase = 0;
+		this->sum_fp64 = sum_fp64 && !DSDPCMSample<real_t>::fixed;
+	}
+	void free() {
+		if (phase_coefs) {
+			DSDPCMUtil::mem_free(phase_coefs);
+			phase_coefs = nullptr;
+		}
+		if (fir_buffer) {
+			DSDPCMUtil::mem_free(fir_buffer);
+			fir_buffer = nullptr;
+		}
+	}
+	int get_interpolation() {
+		return interpolation;
+	}
+	int get_decimation() {
+		return decimation;
+	}
+	float get_delay() {
+		return (float)(interpolation * taps - 1) / 2 / decimation;
+	}
+	int get_samples(int pcm_samples) {
+		return (int)(((int64_t)pcm_samples * interpolation + decimation - 1) / decimation);
+	}
+	int run(real_t* pcm_data, real_t* out_data, int pcm_samples) {
+		if (sum_fp64) {
+			return run<double>(pcm_data, out_data, pcm_samples);
+		}
+		return run<accum_t>(pcm_data, out_data, pcm_samples);
+	}
+private:
+	template<typename sum_t>
+	int run(real_t* pcm_data, real_t* out_data, int pcm_samples) {
+		int out_samples = 0;
+		for (int sample = 0; sample < pcm_samples; sample++) {
+			real_t* buf_lo = fir_buffer + fir_index * channels;
+			real_t* buf_hi = fir_buffer + (fir_index + taps) * channels;
+			for (int ch = 0; ch < channels; ch++) {
+				buf_hi[ch] = buf_lo[ch] = pcm_data[ch];
+			}
+			pcm_data += channels;
+			fir_index = (fir_index + 1) % taps;
+			const real_t* fir_window = fir_buffer + fir_index * channels;
+			while (phase < interpolation) {
+				const real_t* coefs = phase_coefs + phase * taps;
+				real_t* out = out_data + out_samples * channels;
+				for (int ch = 0; ch < channels; ch++) {
+					const real_t* buf = fir_window + ch;
+					sum_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+					for (int j = 0; j < taps; j += 4) {
+						acc0 += (sum_t)coefs[j + 0] * buf[(j + 0) * channels];
+						acc1 += (sum_t)coefs[j + 1] * buf[(j + 1) * channels];
+						acc2 += (sum_t)coefs[j + 2] * buf[(j + 2) * channels];
+						acc3 += (sum_t)coefs[j + 3] * buf[(j + 3) * channels];
+					}
+					out[ch] = DSDPCMSample<real_t>::from_dot((accum_t)((acc0 + acc1) + (acc2 + acc3)));
+				}
+				out_samples++;
+				phase += decimation;
+			}
+			phase -= interpolation;
+		}
+		return out_samples;
+	}
+	static double bessel_i0(double x) {
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 64; k++) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < sum * 1e-17) {
+				break;
+			}
+		}
+		return sum;
+	}
+	void make_coefs(double* fir_coefs, int fir_length) {
+		const double pi = 3.14159265358979323846;
+		const double beta = 9.0;
+		double fc = 0.5 / (interpolation > decimation ? interpolation : decimation);
+		double center = (fir_length - 1) / 2.0;
+		double i0_beta = bessel_i0(beta);
+		double sum = 0.0;
+		for (int k = 0; k < fir_length; k++) {
+			double x = k - center;
+			double sinc = (x == 0.0) ? 2.0 * fc : sin(2.0 * pi * fc * x) / (pi * x);
+			double r = x / (center + 1.0);
+			double window = bessel_i0(beta * sqrt(1.0 - r * r)) / i0_beta;
+			fir_coefs[k] = sinc * window;
+			sum += fir_coefs[k];
+		}
+		for (int k = 0; k < fir_length; k++) {
+			fir_coefs[k] *= interpolation / sum;
+		}
+	}
+};